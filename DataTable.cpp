@@ -0,0 +1,80 @@
+#include "DataTable.hpp"
+
+#include <cstring>
+
+using namespace std;
+
+/**
+ * @brief 解码 DATA 记录并写入对应组, 仅 io 线程调用
+ * @param records 数据报头部之后的记录, 末尾不足一条的字节忽略
+ * @param serial 包序号, 非 0
+ * @return 组序号越界的记录数量
+ */
+size_t DataTable::decode (const string_view records, const uint32_t serial) noexcept {
+    size_t unknown{0};
+    for (size_t i = 0; i + RECORD_SIZE <= records.size(); i += RECORD_SIZE) {
+        int32_t index;
+        memcpy(&index, records.data() + i, sizeof(index));
+        if ((index < 0) || (index >= GROUP_COUNT)) {
+            ++unknown;
+            continue;
+        }
+        Group &target = groups[index];
+        array<uint64_t, GROUP_VALUES / 2> words;
+        memcpy(words.data(), records.data() + i + 4, sizeof(words)); // 8 个值整块拷贝
+        // 顺序锁写入
+        const uint32_t begin = target.sequence.load(memory_order_relaxed);
+        target.sequence.store(begin + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (size_t k = 0; k < words.size(); ++k)
+            target.words[k].store(words[k], memory_order_relaxed);
+        target.sequence.store(begin + 2, memory_order_release);
+        target.serial.store(serial, memory_order_release);
+    }
+    return unknown;
+}
+
+/**
+ * @brief 获取组
+ * @param index 组序号
+ * @return 越界时为 nullptr
+ */
+const DataTable::Group* DataTable::group (const int32_t index) const noexcept {
+    if ((index < 0) || (index >= GROUP_COUNT))
+        return nullptr;
+    return &groups[index];
+}
+
+/**
+ * @brief 读取组内 8 个值
+ * @return 越界或尚未收到时为空
+ */
+optional<DataTable::Values> DataTable::load (const int32_t index) const noexcept {
+    const Group* target = group(index);
+    Values out;
+    if ((target == nullptr) || !read(*target, out))
+        return nullopt;
+    return out;
+}
+
+/**
+ * @brief 拷贝出一致的 8 个值, 与写入冲突时重试
+ * @return 尚未收到时返回 false
+ */
+bool DataTable::read (const Group &group, Values &out) noexcept {
+    if (group.serial.load(memory_order_acquire) == 0)
+        return false;
+    while (true) {
+        const uint32_t begin = group.sequence.load(memory_order_acquire);
+        if ((begin & 1) != 0)
+            continue;
+        array<uint64_t, GROUP_VALUES / 2> words;
+        for (size_t k = 0; k < words.size(); ++k)
+            words[k] = group.words[k].load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (group.sequence.load(memory_order_relaxed) == begin) {
+            memcpy(out.data(), words.data(), sizeof(words));
+            return true;
+        }
+    }
+}
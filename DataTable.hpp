@@ -0,0 +1,78 @@
+#ifndef DATATABLE_HPP
+#define DATATABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/**
+ * @brief DATA 输出的按组存储
+ * DATA 数据报由 36 字节的记录组成: int32 组序号 + 8 个 float, 一个数据报最多 40 组.
+ * 每组 8 个值以顺序锁整体发布, 读者总能读到同一条记录中的 8 个值; io 线程单写, 读者无锁.
+ */
+class DataTable {
+    public:
+        static constexpr int32_t GROUP_COUNT{256}; // 组序号上限
+        static constexpr size_t GROUP_VALUES{8};
+        static constexpr size_t RECORD_SIZE{4 + GROUP_VALUES * sizeof(float)};
+        using Values = std::array<float, GROUP_VALUES>;
+
+        struct alignas(64) Group {
+            std::atomic<uint32_t> sequence{0}; // 奇数表示正在写入
+            std::atomic<uint32_t> serial{0}; // 最近一次写入的包序号, 0 为尚未收到
+            std::array<std::atomic<uint64_t>, GROUP_VALUES / 2> words{}; // 两个 float 一个字
+        };
+
+        DataTable () = default;
+        DataTable (const DataTable &) = delete;
+        DataTable &operator= (const DataTable &) = delete;
+
+        size_t decode (std::string_view records, uint32_t serial) noexcept;
+        [[nodiscard]] const Group* group (int32_t index) const noexcept;
+        [[nodiscard]] std::optional<Values> load (int32_t index) const noexcept;
+        static bool read (const Group &group, Values &out) noexcept;
+    private:
+        std::array<Group, GROUP_COUNT> groups{};
+};
+
+/**
+ * @brief DATA 组句柄, 读取无锁无查找
+ */
+class DataGroupHandle {
+    public:
+        DataGroupHandle () = default;
+        DataGroupHandle (const int32_t index, const DataTable::Group* group): index_(index), group(group) {}
+
+        /**
+         * @brief 读出组内 8 个值
+         * @return 尚未收到或句柄无效时为空
+         */
+        [[nodiscard]] std::optional<DataTable::Values> get () const noexcept {
+            DataTable::Values out;
+            if (!read(out))
+                return std::nullopt;
+            return out;
+        }
+
+        bool read (DataTable::Values &out) const noexcept {
+            return (group != nullptr) && DataTable::read(*group, out);
+        }
+
+        /**
+         * @brief 最近一次写入的包序号, 0 为尚未收到
+         */
+        [[nodiscard]] uint32_t serial () const noexcept {
+            return (group == nullptr) ? 0 : group->serial.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] int32_t index () const noexcept { return index_; }
+        [[nodiscard]] bool valid () const noexcept { return group != nullptr; }
+        explicit operator bool () const noexcept { return valid(); }
+    private:
+        int32_t index_{-1};
+        const DataTable::Group* group{nullptr};
+};
+
+#endif //DATATABLE_HPP
@@ -0,0 +1,140 @@
+#ifndef DATAREFCATALOG_HPP
+#define DATAREFCATALOG_HPP
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+enum class CatalogType : uint8_t { INT, FLOAT, DOUBLE, BYTE, DATA };
+
+struct CatalogEntry {
+    std::string_view name;
+    CatalogType type;
+    int32_t length; // 数组长度, 0 为单值
+    bool writable;
+    int32_t slot; // 在实例 id 表中的位置, 数组为本名, 其后依次为各元素
+};
+
+// 编目数据: 默认为仓库中常用 dataref 的摘录, 以 -DXPLANEUDP_DATAREFS=<DataRefs.txt> 构建时改为由完整列表生成
+#ifdef XPLANEUDP_CATALOG
+#include XPLANEUDP_CATALOG
+#else
+#include "DatarefCatalogData.hpp"
+#endif
+
+/**
+ * @brief 编目中的 dataref, 编译期由名称解析, 数组元素用 ref[i]
+ */
+struct CatalogRef {
+    int32_t entry{-1};
+    int index{-1};
+
+    constexpr CatalogRef operator[] (const int element) const noexcept { return {entry, element}; }
+};
+
+/**
+ * @brief 由 DataRefs.txt 生成的 dataref 编目, 名称经完美哈希 (分桶 + 每桶种子) 定位, 查找不分配内存也不加锁
+ * 查找可在编译期完成: constexpr auto lat = "sim/flightmodel/position/latitude"_dref;
+ */
+class DatarefCatalog {
+    public:
+        static constexpr int32_t SLOTS{catalog_data::SLOTS}; // 实例 id 表大小
+
+        /**
+         * @brief 带种子的 64 位哈希, 生成器与查找共用
+         */
+        static constexpr uint64_t hash (const std::string_view text, const uint64_t seed) noexcept {
+            uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+            for (const char c : text) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 0x100000001b3ULL;
+            }
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            return h ^ (h >> 33);
+        }
+
+        /**
+         * @brief 名称所在条目
+         * @return 条目序号, 不在编目中为 -1
+         */
+        static constexpr int32_t find (const std::string_view name) noexcept {
+            const uint64_t seed = catalog_data::SEEDS[hash(name, 0) % catalog_data::SEEDS.size()];
+            const int32_t entry = catalog_data::TABLE[hash(name, seed) % catalog_data::TABLE.size()];
+            return (catalog_data::ENTRIES[entry].name == name) ? entry : -1;
+        }
+
+        /**
+         * @brief 编目中标记为只读的 dataref, 写入会被 XPlane 忽略
+         * @param name 不带下标的名称
+         */
+        static constexpr bool readOnly (const std::string_view name) noexcept {
+            const int32_t found = find(name);
+            return (found >= 0) && !entry(found).writable;
+        }
+
+        static constexpr const CatalogEntry &entry (const int32_t index) noexcept {
+            return catalog_data::ENTRIES[index];
+        }
+
+        static constexpr size_t size () noexcept {
+            return catalog_data::ENTRIES.size();
+        }
+
+        /**
+         * @brief 名称与下标在实例 id 表中的位置
+         * @param name 不带下标的名称
+         * @param index 数组元素下标, -1 为单值或数组本名
+         * @return 不在编目中或下标越界时为 -1
+         */
+        static constexpr int32_t slot (const std::string_view name, const int index = -1) noexcept {
+            const int32_t found = find(name);
+            return (found < 0) ? -1 : slot(CatalogRef{found, index});
+        }
+
+        static constexpr int32_t slot (const CatalogRef ref) noexcept {
+            if ((ref.entry < 0) || (static_cast<size_t>(ref.entry) >= size()))
+                return -1;
+            const CatalogEntry &found = entry(ref.entry);
+            if (ref.index < 0)
+                return found.slot;
+            return (ref.index < found.length) ? found.slot + 1 + ref.index : -1;
+        }
+
+        /**
+         * @brief 带下标的完整名称 (如 name[3]) 在实例 id 表中的位置
+         */
+        static constexpr int32_t slotOf (const std::string_view fullName) noexcept {
+            if (fullName.empty() || (fullName.back() != ']'))
+                return slot(fullName);
+            const size_t open = fullName.rfind('[');
+            if ((open == std::string_view::npos) || (open + 2 >= fullName.size()))
+                return -1;
+            if ((fullName[open + 1] == '0') && (open + 3 < fullName.size())) // 与拼接出的名称一致, 不带前导零
+                return -1;
+            int index{0};
+            for (size_t i = open + 1; i + 1 < fullName.size(); ++i) {
+                if ((fullName[i] < '0') || (fullName[i] > '9'))
+                    return -1;
+                index = index * 10 + (fullName[i] - '0');
+            }
+            return slot(fullName.substr(0, open), index);
+        }
+
+        /**
+         * @brief 由名称得到编目引用, 不在编目中时抛出, 在常量表达式中即为编译错误
+         */
+        static constexpr CatalogRef ref (const std::string_view name) {
+            const int32_t found = find(name);
+            return (found >= 0) ? CatalogRef{found} : throw std::invalid_argument("Dataref not in catalog.");
+        }
+};
+
+namespace catalog_literals {
+    constexpr CatalogRef operator""_dref (const char* text, const size_t length) {
+        return DatarefCatalog::ref({text, length});
+    }
+}
+
+#endif //DATAREFCATALOG_HPP
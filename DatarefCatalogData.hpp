@@ -0,0 +1,51 @@
+// 由 XPlaneCatalog 从 DataRefs.txt 生成, 勿手工修改; 仅由 DatarefCatalog.hpp 包含
+// 36 项
+namespace catalog_data {
+    constexpr std::array<CatalogEntry, 36> ENTRIES{{
+        {"sim/aircraft/engine/acf_num_engines", CatalogType::INT, 0, true, 0},
+        {"sim/aircraft/view/acf_tailnum", CatalogType::BYTE, 40, true, 1},
+        {"sim/cockpit/radios/com1_freq_hz", CatalogType::INT, 0, true, 42},
+        {"sim/cockpit/radios/com2_freq_hz", CatalogType::INT, 0, true, 43},
+        {"sim/cockpit/radios/nav1_freq_hz", CatalogType::INT, 0, true, 44},
+        {"sim/cockpit/radios/nav2_freq_hz", CatalogType::INT, 0, true, 45},
+        {"sim/cockpit/radios/transponder_code", CatalogType::INT, 0, true, 46},
+        {"sim/cockpit2/controls/flap_ratio", CatalogType::FLOAT, 0, true, 47},
+        {"sim/cockpit2/controls/gear_handle_down", CatalogType::INT, 0, true, 48},
+        {"sim/cockpit2/controls/parking_brake_ratio", CatalogType::FLOAT, 0, true, 49},
+        {"sim/cockpit2/engine/actuators/throttle_ratio", CatalogType::FLOAT, 16, true, 50},
+        {"sim/cockpit2/gauges/indicators/airspeed_kts_pilot", CatalogType::FLOAT, 0, false, 67},
+        {"sim/cockpit2/gauges/indicators/altitude_ft_pilot", CatalogType::FLOAT, 0, false, 68},
+        {"sim/cockpit2/gauges/indicators/heading_AHARS_deg_mag_pilot", CatalogType::FLOAT, 0, false, 69},
+        {"sim/cockpit2/gauges/indicators/vvi_fpm_pilot", CatalogType::FLOAT, 0, false, 70},
+        {"sim/flightmodel/engine/ENGN_EGT_c", CatalogType::FLOAT, 16, true, 71},
+        {"sim/flightmodel/engine/ENGN_FF_", CatalogType::FLOAT, 16, true, 88},
+        {"sim/flightmodel/engine/ENGN_N1_", CatalogType::FLOAT, 16, true, 105},
+        {"sim/flightmodel/engine/ENGN_N2_", CatalogType::FLOAT, 16, true, 122},
+        {"sim/flightmodel/position/elevation", CatalogType::DOUBLE, 0, false, 139},
+        {"sim/flightmodel/position/groundspeed", CatalogType::FLOAT, 0, false, 140},
+        {"sim/flightmodel/position/indicated_airspeed", CatalogType::FLOAT, 0, true, 141},
+        {"sim/flightmodel/position/latitude", CatalogType::DOUBLE, 0, false, 142},
+        {"sim/flightmodel/position/local_vx", CatalogType::FLOAT, 0, true, 143},
+        {"sim/flightmodel/position/local_vy", CatalogType::FLOAT, 0, true, 144},
+        {"sim/flightmodel/position/local_vz", CatalogType::FLOAT, 0, true, 145},
+        {"sim/flightmodel/position/longitude", CatalogType::DOUBLE, 0, false, 146},
+        {"sim/flightmodel/position/phi", CatalogType::FLOAT, 0, true, 147},
+        {"sim/flightmodel/position/psi", CatalogType::FLOAT, 0, true, 148},
+        {"sim/flightmodel/position/theta", CatalogType::FLOAT, 0, true, 149},
+        {"sim/flightmodel/position/vh_ind", CatalogType::FLOAT, 0, false, 150},
+        {"sim/flightmodel/position/y_agl", CatalogType::FLOAT, 0, false, 151},
+        {"sim/flightmodel2/gear/deploy_ratio", CatalogType::FLOAT, 10, true, 152},
+        {"sim/network/misc/network_time_sec", CatalogType::FLOAT, 0, false, 163},
+        {"sim/time/total_running_time_sec", CatalogType::FLOAT, 0, false, 164},
+        {"sim/time/zulu_time_sec", CatalogType::FLOAT, 0, true, 165},
+    }};
+    constexpr int32_t SLOTS{166};
+    constexpr std::array<uint32_t, 9> SEEDS{{
+        17, 236, 56, 72, 117, 2, 0, 2, 208,
+    }};
+    constexpr std::array<int32_t, 36> TABLE{{
+        35, 32, 12, 15, 19, 27, 29, 16, 23, 17, 13, 14, 2, 8, 25, 31,
+        18, 5, 30, 24, 9, 10, 26, 6, 33, 0, 34, 20, 22, 28, 7, 4,
+        11, 21, 1, 3,
+    }};
+}
@@ -0,0 +1,139 @@
+#include "DatarefGroup.hpp"
+
+#include <algorithm>
+
+namespace {
+    /**
+     * @brief 按字段类型转换后写入, 只写该类型的宽度
+     */
+    template <typename T>
+    void put (unsigned char* target, const float value) noexcept {
+        const auto converted = static_cast<T>(value);
+        memcpy(target, &converted, sizeof(T));
+    }
+}
+
+/**
+ * @param size 用户结构体大小
+ * @param fields 字段布局, 每个字段持有一次成员订阅
+ * @param freq 成员订阅的频率
+ */
+GroupCore::GroupCore (const size_t size, std::vector<Field> fields, const int32_t freq):
+    size_(size), fields(std::move(fields)), freq(freq), staging(new unsigned char[size]()),
+    snapshot(new std::atomic<uint64_t>[(size + 7) / 8]()), words((size + 7) / 8) {}
+
+/**
+ * @brief 若有成员在上次发布后更新, 则重新组装并发布快照, 仅 io 线程调用
+ * @return 是否发布
+ */
+bool GroupCore::publish () noexcept {
+    uint32_t newest{0};
+    for (const auto &field : fields) {
+        const uint32_t serial = field.member.serial();
+        if (serial == 0) // 尚不完整或已移除
+            return false;
+        if ((newest == 0) || (static_cast<int32_t>(serial - newest) > 0))
+            newest = serial;
+    }
+    if (newest == lastSerial)
+        return false;
+    lastSerial = newest;
+    for (const auto &field : fields) {
+        const float value = DatarefTable::decodeValue(field.member.slot()->load(std::memory_order_relaxed)); // 仅 io 线程写入, 与上面读到的一致
+        unsigned char* target = staging.get() + field.offset;
+        switch (field.type) {
+            case FieldType::FLOAT: put<float>(target, value);
+                break;
+            case FieldType::DOUBLE: put<double>(target, value);
+                break;
+            case FieldType::INT8: put<int8_t>(target, value);
+                break;
+            case FieldType::INT16: put<int16_t>(target, value);
+                break;
+            case FieldType::INT32: put<int32_t>(target, value);
+                break;
+            case FieldType::INT64: put<int64_t>(target, value);
+                break;
+            case FieldType::UINT8: put<uint8_t>(target, value);
+                break;
+            case FieldType::UINT16: put<uint16_t>(target, value);
+                break;
+            case FieldType::UINT32: put<uint32_t>(target, value);
+                break;
+            case FieldType::UINT64: put<uint64_t>(target, value);
+                break;
+            case FieldType::BOOL: put<bool>(target, value != 0.0f);
+                break;
+        }
+    }
+    // 顺序锁写入
+    const uint32_t begin = sequence.load(std::memory_order_relaxed);
+    sequence.store(begin + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t word{0};
+        memcpy(&word, staging.get() + i * 8, std::min<size_t>(8, size_ - i * 8));
+        snapshot[i].store(word, std::memory_order_relaxed);
+    }
+    sequence.store(begin + 2, std::memory_order_release);
+    published.store(newest, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief 拷贝出一致的快照, 与写入冲突时重试
+ * @param out 用户结构体
+ * @return 尚未发布过时返回 false
+ */
+bool GroupCore::read (void* out) const noexcept {
+    if (published.load(std::memory_order_acquire) == 0)
+        return false;
+    while (true) {
+        const uint32_t begin = sequence.load(std::memory_order_acquire);
+        if ((begin & 1) != 0)
+            continue;
+        auto* target = static_cast<unsigned char*>(out);
+        for (size_t i = 0; i < words; ++i) {
+            const uint64_t word = snapshot[i].load(std::memory_order_relaxed);
+            memcpy(target + i * 8, &word, std::min<size_t>(8, size_ - i * 8));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == begin)
+            return true;
+    }
+}
+
+uint32_t GroupCore::serial () const noexcept {
+    return published.load(std::memory_order_acquire);
+}
+
+size_t GroupCore::size () const noexcept {
+    return size_;
+}
+
+/**
+ * @brief 成员订阅, 按字段顺序
+ */
+std::vector<DatarefHandle<>> GroupCore::members () const {
+    std::vector<DatarefHandle<>> result;
+    result.reserve(fields.size());
+    for (const auto &field : fields)
+        result.push_back(field.member);
+    return result;
+}
+
+const std::vector<GroupCore::Field> &GroupCore::layout () const noexcept {
+    return fields;
+}
+
+int32_t GroupCore::frequency () const noexcept {
+    return freq;
+}
+
+/**
+ * @brief 标记组已移除, 成员订阅只退订一次
+ * @return 首次调用时为 true
+ */
+bool GroupCore::release () noexcept {
+    return !released.exchange(true);
+}
@@ -0,0 +1,141 @@
+#ifndef DATAREFGROUP_HPP
+#define DATAREFGROUP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "DatarefHandle.hpp"
+
+/**
+ * @brief dataref 组的非模板部分: 成员订阅 (名称, 索引与频率, 移除组时逐个退订), 字段布局与顺序锁保护的快照缓冲区
+ * io 线程在每批数据处理完后发布一次, 读者整块拷贝快照, 遇到并发写入则重试; 任一成员被移除后不再发布
+ */
+class GroupCore {
+    public:
+        enum class FieldType : uint8_t { FLOAT, DOUBLE, INT8, INT16, INT32, INT64, UINT8, UINT16, UINT32, UINT64, BOOL };
+        struct Field {
+            std::string dataRef;
+            int index;
+            DatarefHandle<> member;
+            size_t offset;
+            FieldType type;
+        };
+
+        GroupCore (size_t size, std::vector<Field> fields, int32_t freq);
+        bool publish () noexcept;
+        bool read (void* out) const noexcept;
+        [[nodiscard]] uint32_t serial () const noexcept;
+        [[nodiscard]] size_t size () const noexcept;
+        [[nodiscard]] std::vector<DatarefHandle<>> members () const;
+        [[nodiscard]] const std::vector<Field> &layout () const noexcept;
+        [[nodiscard]] int32_t frequency () const noexcept;
+        bool release () noexcept;
+    private:
+        const size_t size_;
+        const std::vector<Field> fields;
+        const int32_t freq;
+        std::atomic<bool> released{false};
+        std::unique_ptr<unsigned char[]> staging; // 仅 io 线程使用
+        std::unique_ptr<std::atomic<uint64_t>[]> snapshot; // 顺序锁保护, 按字原子读写以免数据竞争
+        const size_t words;
+        std::atomic<uint32_t> sequence{0}; // 奇数表示正在写入
+        std::atomic<uint32_t> published{0}; // 快照对应的最新包序号, 0 为尚未完整
+        uint32_t lastSerial{0}; // 仅 io 线程使用
+};
+
+/**
+ * @brief 组字段: dataref 名称到结构体成员的映射
+ * 成员指针在 C++17 中无法在编译期换算成偏移, 偏移在构造时按未构造的对齐存储求出, 不要求 S 可默认构造;
+ * 字段类型在编译期确定, 每个字段只换算一次, 发布时按偏移直接写入
+ * @tparam S 可平凡拷贝的用户结构体
+ */
+template <typename S>
+struct GroupField {
+    static_assert(std::is_trivially_copyable_v<S>, "Group struct must be trivially copyable.");
+
+    template <typename M>
+    GroupField (std::string dataRef, M S::* member, const int index = -1): dataRef(std::move(dataRef)), index(index) {
+        static_assert(std::is_arithmetic_v<M>, "Group field must be arithmetic.");
+        alignas(S) unsigned char storage[sizeof(S)]; // 只取成员地址, 不读写
+        const auto* probe = reinterpret_cast<const S*>(storage);
+        offset = reinterpret_cast<const unsigned char*>(&(probe->*member)) - storage;
+        if constexpr (std::is_same_v<M, float>)
+            type = GroupCore::FieldType::FLOAT;
+        else if constexpr (std::is_same_v<M, double>)
+            type = GroupCore::FieldType::DOUBLE;
+        else if constexpr (std::is_same_v<M, bool>)
+            type = GroupCore::FieldType::BOOL;
+        else
+            type = integerType<M>();
+    }
+
+    std::string dataRef;
+    int index;
+    size_t offset{};
+    GroupCore::FieldType type{};
+private:
+    /**
+     * @brief 整数成员按宽度与符号对应字段类型, 写入宽度与成员一致
+     */
+    template <typename M>
+    static constexpr GroupCore::FieldType integerType () noexcept {
+        static_assert(std::is_integral_v<M>, "Group field must be float, double, bool or an integer.");
+        static_assert((sizeof(M) == 1) || (sizeof(M) == 2) || (sizeof(M) == 4) || (sizeof(M) == 8),
+                      "Unsupported group field width.");
+        if constexpr (sizeof(M) == 1)
+            return std::is_signed_v<M> ? GroupCore::FieldType::INT8 : GroupCore::FieldType::UINT8;
+        else if constexpr (sizeof(M) == 2)
+            return std::is_signed_v<M> ? GroupCore::FieldType::INT16 : GroupCore::FieldType::UINT16;
+        else if constexpr (sizeof(M) == 4)
+            return std::is_signed_v<M> ? GroupCore::FieldType::INT32 : GroupCore::FieldType::UINT32;
+        else
+            return std::is_signed_v<M> ? GroupCore::FieldType::INT64 : GroupCore::FieldType::UINT64;
+    }
+};
+
+/**
+ * @brief dataref 组句柄, 读出同一批数据下的一致快照
+ * @tparam S 可平凡拷贝的用户结构体, 字段由 GroupField 声明
+ */
+template <typename S>
+class DatarefGroup {
+    static_assert(std::is_trivially_copyable_v<S>, "Group struct must be trivially copyable.");
+    public:
+        DatarefGroup () = default;
+        explicit DatarefGroup (std::shared_ptr<GroupCore> core): core(std::move(core)) {}
+
+        /**
+         * @brief 读出快照
+         * @return 有成员尚未收到过或句柄无效时为空
+         */
+        [[nodiscard]] std::optional<S> get () const noexcept {
+            S out;
+            if (!read(out))
+                return std::nullopt;
+            return out;
+        }
+
+        bool read (S &out) const noexcept {
+            return core && core->read(&out);
+        }
+
+        /**
+         * @brief 快照对应的最新包序号, 0 为尚未完整
+         */
+        [[nodiscard]] uint32_t serial () const noexcept {
+            return core ? core->serial() : 0;
+        }
+
+        [[nodiscard]] const std::shared_ptr<GroupCore> &handle () const noexcept { return core; }
+        [[nodiscard]] bool valid () const noexcept { return core != nullptr; }
+        explicit operator bool () const noexcept { return valid(); }
+    private:
+        std::shared_ptr<GroupCore> core{};
+};
+
+#endif //DATAREFGROUP_HPP
@@ -0,0 +1,254 @@
+#ifndef DATAREFHANDLE_HPP
+#define DATAREFHANDLE_HPP
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include "DatarefTable.hpp"
+
+/**
+ * @brief 单个 dataref 的订阅句柄, 直接指向值表槽位
+ * 读取为槽位前后各核对一次代数: 无锁, 无分配, 无查找. 复用的 id 在 io 线程清空槽位前读不出上一个订阅的值;
+ * 订阅被移除 (最后一个使用者退订) 后句柄失效, 之后即使 id 分给其他 dataref 也读不到新值.
+ * 句柄不拥有槽位, 不得超出所属 XPlaneUdp 的生命周期
+ * @tparam T 读出时转换的类型
+ */
+template <typename T = float>
+class DatarefHandle {
+    static_assert(std::is_arithmetic_v<T>, "DatarefHandle value type must be arithmetic.");
+    public:
+        DatarefHandle () = default;
+
+        /**
+         * @param generation id 的代数, 记下对应的可用代数; 为空时不检查 (如共享内存中的槽位). 须在 id 可能被释放前创建
+         */
+        DatarefHandle (const int32_t id, const DatarefTable::Slot* slot,
+                       const DatarefTable::Generation* generation = nullptr):
+            id_(id), slot_(slot), generation_(generation),
+            live_((generation == nullptr) ? 0 : DatarefTable::live(generation->load(std::memory_order_acquire))) {}
+
+        template <typename U>
+        explicit DatarefHandle (const DatarefHandle<U> &other): id_(other.id_), slot_(other.slot_),
+                                                                 generation_(other.generation_), live_(other.live_) {}
+
+        /**
+         * @brief 最新值
+         * @return 尚未收到或句柄无效时为空
+         */
+        [[nodiscard]] std::optional<T> get () const noexcept {
+            if ((slot_ == nullptr) || !current()) // 先核对代数再读值, 可用代数之后的槽位已清空
+                return std::nullopt;
+            const uint64_t word = slot_->load(std::memory_order_acquire);
+            if ((DatarefTable::decodeSerial(word) == 0) || !current()) // 复用后的写入必然晚于代数变化
+                return std::nullopt;
+            return static_cast<T>(DatarefTable::decodeValue(word));
+        }
+
+        /**
+         * @brief 最新值, 尚未收到时返回 fallback
+         */
+        [[nodiscard]] T value (const T fallback = T{}) const noexcept {
+            return get().value_or(fallback);
+        }
+
+        /**
+         * @brief 最近一次写入所在的包序号, 0 为尚未收到
+         */
+        [[nodiscard]] uint32_t serial () const noexcept {
+            if ((slot_ == nullptr) || !current())
+                return 0;
+            const uint32_t received = DatarefTable::decodeSerial(slot_->load(std::memory_order_acquire));
+            return current() ? received : 0;
+        }
+
+        /**
+         * @brief 槽位可读, 即已清空且创建后 id 未被释放
+         */
+        [[nodiscard]] bool current () const noexcept {
+            return (generation_ == nullptr) || (generation_->load(std::memory_order_acquire) == live_);
+        }
+
+        [[nodiscard]] int32_t id () const noexcept { return id_; }
+        [[nodiscard]] const DatarefTable::Slot* slot () const noexcept { return slot_; }
+        [[nodiscard]] bool valid () const noexcept {
+            return (slot_ != nullptr) &&
+                   ((generation_ == nullptr) ||
+                    (static_cast<int32_t>(generation_->load(std::memory_order_acquire) - live_) <= 0)); // 尚未清空也有效
+        }
+        explicit operator bool () const noexcept { return valid(); }
+    private:
+        template <typename>
+        friend class DatarefHandle;
+
+        int32_t id_{-1};
+        const DatarefTable::Slot* slot_{nullptr};
+        const DatarefTable::Generation* generation_{nullptr};
+        uint32_t live_{0}; // 创建时的可用代数
+};
+
+/**
+ * @brief dataref 数组的订阅句柄, 持有各元素槽位与代数
+ * 各元素 id 连续时 (新订阅的数组总是如此) 直接按首个槽位顺序读取; 元素与先前的单个订阅共用时逐个经槽位指针读取.
+ * 读取无锁无分配, 各元素分别原子读取, 同一次读取可能跨相邻两个包; 任一元素的 id 被释放后句柄失效
+ * @tparam N 编译期长度, 0 为运行期长度
+ */
+template <size_t N = 0>
+class ArrayHandle {
+    template <typename P>
+    using Elements = std::conditional_t<N == 0, std::vector<const P*>, std::array<const P*, N>>;
+    using Slots = Elements<DatarefTable::Slot>;
+    using Generations = Elements<DatarefTable::Generation>;
+    using Lives = std::conditional_t<N == 0, std::vector<uint32_t>, std::array<uint32_t, N>>;
+    public:
+        ArrayHandle () = default;
+
+        /**
+         * @param generations 各元素 id 的代数, 记下对应的可用代数; 为空时不检查. 须在 id 可能被释放前创建
+         */
+        ArrayHandle (const int32_t id, Slots slots, Generations generations = {}):
+            id_(id), slots_(std::move(slots)), generations_(std::move(generations)), lives_(livesOf(generations_)),
+            base_(contiguous(slots_)) {}
+
+        /**
+         * @brief 在运行期长度与编译期长度之间转换, 长度不同时为空句柄
+         */
+        template <size_t M>
+        explicit ArrayHandle (const ArrayHandle<M> &other) {
+            if ((N != 0) && (other.slots_.size() != N))
+                return;
+            id_ = other.id_;
+            if constexpr (N == 0) {
+                slots_.assign(other.slots_.begin(), other.slots_.end());
+                generations_.assign(other.generations_.begin(), other.generations_.end());
+                lives_.assign(other.lives_.begin(), other.lives_.end());
+            } else {
+                std::copy(other.slots_.begin(), other.slots_.end(), slots_.begin());
+                if (other.generations_.size() == N) {
+                    std::copy(other.generations_.begin(), other.generations_.end(), generations_.begin());
+                    std::copy(other.lives_.begin(), other.lives_.end(), lives_.begin());
+                }
+            }
+            base_ = other.base_;
+        }
+
+        /**
+         * @brief 一次读出全部元素
+         * @param out 至少 size() 个元素的输出区
+         * @param serial 可选, 写入各元素中最新的包序号
+         * @return 任一元素尚未收到或句柄无效时返回 false
+         */
+        bool read (float* out, uint32_t* serial = nullptr) const noexcept {
+            if ((id_ < 0) || !current()) // 先核对代数再读值
+                return false;
+            uint32_t newest{0};
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                const uint64_t word = ((base_ != nullptr) ? base_[i] : *slots_[i]).load(std::memory_order_acquire);
+                const uint32_t element = DatarefTable::decodeSerial(word);
+                if (element == 0)
+                    return false;
+                newest = (element > newest) ? element : newest;
+                out[i] = DatarefTable::decodeValue(word);
+            }
+            if (!current())
+                return false;
+            if (serial != nullptr)
+                *serial = newest;
+            return true;
+        }
+
+        /**
+         * @brief 读入定长数组, 长度不足时返回 false
+         */
+        template <size_t M>
+        bool read (std::array<float, M> &out, uint32_t* serial = nullptr) const noexcept {
+            static_assert((N == 0) || (M >= N), "Output array shorter than the dataref array.");
+            return (M >= slots_.size()) && read(out.data(), serial);
+        }
+
+        /**
+         * @brief 最新值, N 为 0 时返回 vector (有分配)
+         */
+        [[nodiscard]] auto get () const {
+            if constexpr (N == 0) {
+                std::vector<float> container(slots_.size());
+                return read(container.data()) ? std::optional{std::move(container)} : std::nullopt;
+            } else {
+                std::array<float, N> container{};
+                return read(container.data()) ? std::optional{container} : std::nullopt;
+            }
+        }
+
+        /**
+         * @brief 各元素中最新的包序号, 任一元素尚未收到时为 0; 不变即数组未更新
+         */
+        [[nodiscard]] uint32_t serial () const noexcept {
+            if (!current())
+                return 0;
+            uint32_t newest{0};
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                const uint32_t element = DatarefTable::decodeSerial(slots_[i]->load(std::memory_order_acquire));
+                if (element == 0)
+                    return 0;
+                newest = (element > newest) ? element : newest;
+            }
+            return current() ? newest : 0;
+        }
+
+        /**
+         * @brief 各元素槽位均可读, 即已清空且创建后 id 均未被释放
+         */
+        [[nodiscard]] bool current () const noexcept {
+            for (size_t i = 0; i < generations_.size(); ++i)
+                if ((generations_[i] != nullptr) && (generations_[i]->load(std::memory_order_acquire) != lives_[i]))
+                    return false;
+            return true;
+        }
+
+        [[nodiscard]] int32_t id () const noexcept { return id_; }
+        [[nodiscard]] size_t size () const noexcept { return slots_.size(); }
+        [[nodiscard]] const DatarefTable::Slot* slot (const size_t index) const noexcept { return slots_[index]; }
+        [[nodiscard]] const DatarefTable::Slot* data () const noexcept { return base_; } // 元素连续时的首个槽位, 否则为空
+        [[nodiscard]] bool valid () const noexcept {
+            if ((id_ < 0) || (slots_.size() == 0))
+                return false;
+            for (size_t i = 0; i < generations_.size(); ++i) // 尚未清空也有效
+                if ((generations_[i] != nullptr) &&
+                    (static_cast<int32_t>(generations_[i]->load(std::memory_order_acquire) - lives_[i]) > 0))
+                    return false;
+            return true;
+        }
+        explicit operator bool () const noexcept { return valid(); }
+    private:
+        template <size_t>
+        friend class ArrayHandle;
+
+        int32_t id_{-1};
+        Slots slots_{};
+        Generations generations_{}; // 为空或为空指针的元素不检查
+        Lives lives_{}; // 创建时各元素的可用代数
+        const DatarefTable::Slot* base_{nullptr}; // 元素连续存放时的首个槽位
+
+        static Lives livesOf (const Generations &generations) {
+            Lives lives{};
+            if constexpr (N == 0)
+                lives.resize(generations.size());
+            for (size_t i = 0; i < generations.size(); ++i)
+                if (generations[i] != nullptr)
+                    lives[i] = DatarefTable::live(generations[i]->load(std::memory_order_acquire));
+            return lives;
+        }
+
+        static const DatarefTable::Slot* contiguous (const Slots &slots) noexcept {
+            if (slots.size() == 0)
+                return nullptr;
+            const auto first = reinterpret_cast<uintptr_t>(slots[0]);
+            for (size_t i = 1; i < slots.size(); ++i)
+                if (reinterpret_cast<uintptr_t>(slots[i]) != first + i * sizeof(DatarefTable::Slot))
+                    return nullptr;
+            return slots[0];
+        }
+};
+
+#endif //DATAREFHANDLE_HPP
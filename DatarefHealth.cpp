@@ -0,0 +1,100 @@
+#include "DatarefHealth.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief 扩展计数表到已分配 id 上限
+ * @param limit 已分配 id 上限
+ */
+void DatarefHealth::grow (const int32_t limit) {
+    if (updates.size() < static_cast<size_t>(limit))
+        updates.resize(limit, 0);
+}
+
+/**
+ * @brief 检查一次: 换算各订阅的更新频率与最新值时间, 其余订阅仍在更新时找出停更的订阅
+ * 同一订阅重复停更时退避, 间隔从判定阈值起翻倍直到上限
+ * @param subscribed 当前全部订阅
+ * @param table 值表, 槽位中的包序号换算为更新时间
+ * @param clock 包时间环
+ * @param now 当前时间
+ * @return 需要重新发出的 RREF 请求
+ */
+vector<SubscriptionTable::Request> DatarefHealth::check (const vector<SubscriptionTable::Request> &subscribed,
+                                                         const DatarefTable &table, const PacketClock &clock,
+                                                         const Clock::time_point now) {
+    const double seconds = (last == Clock::time_point{}) ? 0 : chrono::duration<double>(now - last).count();
+    last = now;
+    ++generation;
+    bool flowing{false}; // 是否有订阅按时更新
+    for (const auto &request : subscribed) {
+        if (request.freq <= 0)
+            continue;
+        const uint32_t total = (static_cast<size_t>(request.id) < updates.size()) ? updates[request.id] : 0;
+        auto [it, created] = tracks.try_emplace(request.id);
+        Track &track = it->second;
+        if (created || (track.name != request.name)) // 新订阅或 id 已被复用
+            track = Track{request.name, request.freq, total, 0, now};
+        track.freq = request.freq;
+        track.generation = generation;
+        const uint32_t delta = total - track.updates;
+        track.updates = total;
+        if (seconds > 0)
+            track.rate = (track.rate == 0) ? delta / seconds : (track.rate + delta / seconds) / 2;
+        const DatarefTable::Slot* slot = table.slot(request.id);
+        const uint32_t serial = (slot == nullptr) ? 0 : DatarefTable::decodeSerial(slot->load(memory_order_acquire));
+        if ((delta > 0) || (created && (serial != 0))) { // 开始跟踪前已收到的值也计入
+            const auto time = clock.time(serial);
+            track.lastUpdate = time.has_value() ? Clock::time_point(chrono::duration_cast<Clock::duration>(
+                                                                        chrono::nanoseconds(*time))) : now;
+            track.received = true;
+            track.backoff = {};
+        }
+        track.stale = now - track.lastUpdate > limit(track.freq);
+        flowing = flowing || (track.received && !track.stale);
+    }
+    vector<SubscriptionTable::Request> requests;
+    for (auto it = tracks.begin(); it != tracks.end();) {
+        Track &track = it->second;
+        if (track.generation != generation) { // 已退订
+            it = tracks.erase(it);
+            continue;
+        }
+        if (flowing && track.stale && (now >= track.retry)) { // 全部停更时由整体超时处理
+            requests.push_back({it->first, track.freq, track.name});
+            track.backoff = min<Clock::duration>(max<Clock::duration>(track.backoff * 2, limit(track.freq)), RETRY_MAX);
+            track.retry = now + track.backoff;
+            ++track.resubscribes;
+        }
+        ++it;
+    }
+    sort(requests.begin(), requests.end(), [](const auto &a, const auto &b) { return a.id < b.id; });
+    return requests;
+}
+
+/**
+ * @brief 最近一次检查时各订阅的状态, 按 id 排序
+ * @param now 当前时间, 用于换算年龄
+ */
+vector<DatarefStatus> DatarefHealth::status (const Clock::time_point now) const {
+    vector<DatarefStatus> result;
+    result.reserve(tracks.size());
+    for (const auto &[id, track] : tracks) {
+        optional<chrono::nanoseconds> age;
+        if (track.received)
+            age = chrono::duration_cast<chrono::nanoseconds>(max(now - track.lastUpdate, Clock::duration::zero()));
+        result.push_back({track.name, id, track.freq, track.rate, age, track.stale, track.resubscribes});
+    }
+    sort(result.begin(), result.end(), [](const auto &a, const auto &b) { return a.id < b.id; });
+    return result;
+}
+
+/**
+ * @brief 停更判定阈值: 若干个请求周期, 不低于下限
+ */
+DatarefHealth::Clock::duration DatarefHealth::limit (const int32_t freq) noexcept {
+    return max<Clock::duration>(chrono::duration_cast<Clock::duration>(chrono::seconds(STALE_PERIODS)) / max(freq, 1),
+                                STALE_MIN);
+}
@@ -0,0 +1,68 @@
+#ifndef DATAREFHEALTH_HPP
+#define DATAREFHEALTH_HPP
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DatarefTable.hpp"
+#include "PacketClock.hpp"
+#include "Subscriptions.hpp"
+
+struct DatarefStatus { // 单个订阅在最近一次检查时的状态
+    std::string name;
+    int32_t id;
+    int32_t freq; // 请求频率 Hz
+    double rate; // 实测更新频率 Hz
+    std::optional<std::chrono::nanoseconds> age; // 最新值年龄, 尚未收到时为空
+    bool stale; // 超过若干个请求周期未更新
+    uint32_t resubscribes; // 停更后单独重新订阅的次数
+};
+
+/**
+ * @brief 订阅健康检查: 按请求频率判断每个订阅是否停更, 只对停更的订阅重新订阅
+ * XPlane 重载机模后部分 RREF 失效而其余照常, 整体超时不会触发. 更新次数在解码时累加, 检查时换算为频率; 仅 io 线程使用
+ */
+class DatarefHealth {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr auto PERIOD{std::chrono::milliseconds(500)}; // 检查周期
+        static constexpr int32_t STALE_PERIODS{5}; // 超过多少个请求周期未更新视为停更
+        static constexpr auto STALE_MIN{std::chrono::seconds(1)}; // 停更判定下限, 容忍低频订阅的抖动
+        static constexpr auto RETRY_MAX{std::chrono::seconds(30)}; // 重新订阅的退避上限
+
+        /**
+         * @brief 记录一次更新, 调用前已用 grow 覆盖 id
+         */
+        void count (const int32_t id) noexcept { ++updates[id]; }
+
+        void grow (int32_t limit);
+        std::vector<SubscriptionTable::Request> check (const std::vector<SubscriptionTable::Request> &subscribed,
+                                                       const DatarefTable &table, const PacketClock &clock,
+                                                       Clock::time_point now);
+        [[nodiscard]] std::vector<DatarefStatus> status (Clock::time_point now) const;
+    private:
+        struct Track {
+            std::string name;
+            int32_t freq;
+            uint32_t updates; // 上次检查时的累计更新次数
+            double rate{0};
+            Clock::time_point lastUpdate; // 最近一次更新, 尚未收到时为开始跟踪的时间
+            bool received{false};
+            bool stale{false};
+            Clock::time_point retry{}; // 此前不再重新订阅
+            Clock::duration backoff{};
+            uint32_t resubscribes{0};
+            uint64_t generation{0}; // 最近一次出现在订阅表中的检查
+        };
+
+        std::vector<uint32_t> updates; // id -> 累计更新次数
+        std::unordered_map<int32_t, Track> tracks; // 按 id
+        Clock::time_point last{}; // 上次检查时间
+        uint64_t generation{0};
+
+        static Clock::duration limit (int32_t freq) noexcept;
+};
+
+#endif //DATAREFHEALTH_HPP
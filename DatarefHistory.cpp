@@ -0,0 +1,139 @@
+#include "DatarefHistory.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static size_t roundCapacity (const size_t capacity) {
+    size_t rounded{2};
+    while (rounded < capacity)
+        rounded <<= 1;
+    return rounded;
+}
+
+static int64_t toTicks (const HistoryClock::time_point time) {
+    return time.time_since_epoch().count();
+}
+
+/**
+ * @param handle 订阅句柄
+ * @param capacity 样本容量, 向上取整到 2 的幂
+ */
+HistoryRing::HistoryRing (DatarefHandle<> handle, const size_t capacity): handle(handle),
+    mask(roundCapacity(capacity) - 1), times(new atomic<int64_t>[mask + 1]()), values(new atomic<uint32_t>[mask + 1]()) {}
+
+/**
+ * @brief 槽位有新值时追加一个样本, 仅 io 线程调用
+ * @param time 接收时间
+ */
+void HistoryRing::record (const HistoryClock::time_point time) noexcept {
+    const uint64_t word = handle.slot()->load(memory_order_acquire);
+    const uint32_t serial = DatarefTable::decodeSerial(word);
+    if ((serial == 0) || (serial == lastSerial) || !handle.current())
+        return;
+    lastSerial = serial;
+    const uint64_t index = head.load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // 读到新样本的读者必然看到之前的写入计数
+    times[index & mask].store(toTicks(time), memory_order_relaxed);
+    values[index & mask].store(static_cast<uint32_t>(word), memory_order_relaxed);
+    head.store(index + 1, memory_order_release);
+}
+
+HistorySample HistoryRing::load (const uint64_t index) const noexcept {
+    const uint32_t bits = values[index & mask].load(memory_order_relaxed);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return {HistoryClock::time_point{HistoryClock::duration{times[index & mask].load(memory_order_relaxed)}}, value};
+}
+
+/**
+ * @brief 写入计数为 end 时仍可安全读取的最旧样本, 留出一个正在被覆盖的位置
+ */
+uint64_t HistoryRing::oldestValid (const uint64_t end) const noexcept {
+    return (end > mask) ? end - mask : 0;
+}
+
+size_t HistoryRing::latest (HistorySample* out, const size_t count) const noexcept {
+    const uint64_t end = head.load(memory_order_acquire);
+    const uint64_t begin = max<uint64_t>((end > count) ? end - count : 0, oldestValid(end));
+    for (uint64_t i = begin; i < end; ++i)
+        out[i - begin] = load(i);
+    atomic_thread_fence(memory_order_acquire);
+    const uint64_t valid = oldestValid(head.load(memory_order_relaxed));
+    if (valid <= begin)
+        return end - begin;
+    if (valid >= end)
+        return 0;
+    memmove(out, out + (valid - begin), (end - valid) * sizeof(HistorySample)); // 丢弃读取期间被覆盖的样本
+    return end - valid;
+}
+
+vector<HistorySample> HistoryRing::latest (const size_t count) const {
+    vector<HistorySample> samples(min(count, mask + 1));
+    samples.resize(latest(samples.data(), samples.size()));
+    return samples;
+}
+
+vector<HistorySample> HistoryRing::since (const HistoryClock::time_point time) const {
+    const uint64_t end = head.load(memory_order_acquire);
+    uint64_t low = oldestValid(end), high = end;
+    while (low < high) { // 第一个不早于 time 的样本
+        const uint64_t middle = low + (high - low) / 2;
+        if (load(middle).time < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    vector<HistorySample> samples(end - low);
+    samples.resize(latest(samples.data(), samples.size()));
+    samples.erase(samples.begin(), find_if(samples.begin(), samples.end(), [time](const HistorySample &sample) {
+        return sample.time >= time; // 查找期间有新样本写入
+    }));
+    return samples;
+}
+
+optional<float> HistoryRing::at (const HistoryClock::time_point time) const noexcept {
+    while (true) {
+        const uint64_t end = head.load(memory_order_acquire);
+        const uint64_t oldest = oldestValid(end);
+        if (end == oldest)
+            return nullopt;
+        uint64_t low = oldest, high = end;
+        while (low < high) {
+            const uint64_t middle = low + (high - low) / 2;
+            if (load(middle).time < time)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        optional<float> result;
+        uint64_t used{low}; // 用到的最旧样本
+        if (low == end) { // 晚于最新样本, 保持最新值
+            used = end - 1;
+            result = load(used).value;
+        } else if (const HistorySample after = load(low); after.time == time)
+            result = after.value;
+        else if (low > oldest) {
+            used = low - 1;
+            const HistorySample before = load(used);
+            const double ratio = chrono::duration<double>(time - before.time).count() /
+                                 chrono::duration<double>(after.time - before.time).count();
+            result = static_cast<float>(before.value + (after.value - before.value) * ratio);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (oldestValid(head.load(memory_order_relaxed)) <= used)
+            return result;
+    }
+}
+
+size_t HistoryRing::capacity () const noexcept {
+    return mask + 1;
+}
+
+/**
+ * @brief 累计写入的样本数
+ */
+uint64_t HistoryRing::written () const noexcept {
+    return head.load(memory_order_acquire);
+}
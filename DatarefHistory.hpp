@@ -0,0 +1,86 @@
+#ifndef DATAREFHISTORY_HPP
+#define DATAREFHISTORY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "DatarefHandle.hpp"
+
+using HistoryClock = std::chrono::steady_clock;
+
+struct HistorySample {
+    HistoryClock::time_point time; // 接收时间
+    float value;
+};
+
+/**
+ * @brief 单个 dataref 的定长历史环
+ * io 线程单写, 新值覆盖最旧的样本; 读者无锁, 读完后根据写入计数丢弃读取期间可能被覆盖的样本; 订阅被移除后不再追加
+ */
+class HistoryRing {
+    public:
+        HistoryRing (DatarefHandle<> handle, size_t capacity);
+        void record (HistoryClock::time_point time) noexcept;
+        size_t latest (HistorySample* out, size_t count) const noexcept;
+        [[nodiscard]] std::vector<HistorySample> latest (size_t count) const;
+        [[nodiscard]] std::vector<HistorySample> since (HistoryClock::time_point time) const;
+        [[nodiscard]] std::optional<float> at (HistoryClock::time_point time) const noexcept;
+        [[nodiscard]] size_t capacity () const noexcept;
+        [[nodiscard]] uint64_t written () const noexcept;
+    private:
+        const DatarefHandle<> handle;
+        const size_t mask;
+        std::unique_ptr<std::atomic<int64_t>[]> times;
+        std::unique_ptr<std::atomic<uint32_t>[]> values; // float 位模式
+        std::atomic<uint64_t> head{0}; // 已写入样本总数
+        uint32_t lastSerial{0}; // 仅 io 线程使用
+
+        HistorySample load (uint64_t index) const noexcept;
+        uint64_t oldestValid (uint64_t end) const noexcept;
+};
+
+/**
+ * @brief 历史环句柄
+ */
+class DatarefHistory {
+    public:
+        DatarefHistory () = default;
+        explicit DatarefHistory (std::shared_ptr<HistoryRing> ring): ring(std::move(ring)) {}
+
+        /**
+         * @brief 最近 count 个样本写入 out, 按时间从旧到新
+         * @return 实际样本数
+         */
+        size_t latest (HistorySample* out, const size_t count) const noexcept {
+            return ring ? ring->latest(out, count) : 0;
+        }
+
+        [[nodiscard]] std::vector<HistorySample> latest (const size_t count) const {
+            return ring ? ring->latest(count) : std::vector<HistorySample>{};
+        }
+
+        /**
+         * @brief 不早于 time 的所有样本
+         */
+        [[nodiscard]] std::vector<HistorySample> since (const HistoryClock::time_point time) const {
+            return ring ? ring->since(time) : std::vector<HistorySample>{};
+        }
+
+        /**
+         * @brief time 时刻的值, 在相邻样本间线性插值; 早于最旧样本时为空, 晚于最新样本时为最新值
+         */
+        [[nodiscard]] std::optional<float> at (const HistoryClock::time_point time) const noexcept {
+            return ring ? ring->at(time) : std::nullopt;
+        }
+
+        [[nodiscard]] const std::shared_ptr<HistoryRing> &handle () const noexcept { return ring; }
+        [[nodiscard]] bool valid () const noexcept { return ring != nullptr; }
+        explicit operator bool () const noexcept { return valid(); }
+    private:
+        std::shared_ptr<HistoryRing> ring{};
+};
+
+#endif //DATAREFHISTORY_HPP
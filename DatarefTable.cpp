@@ -0,0 +1,20 @@
+#include "DatarefTable.hpp"
+
+#include <stdexcept>
+
+DatarefTable::~DatarefTable () {
+    for (auto &chunk : chunks)
+        delete chunk.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 确保 id 对应槽位已分配, 由订阅方调用, 调用者之间需互斥
+ * @param id dataref 索引
+ */
+void DatarefTable::reserve (const int32_t id) {
+    if ((id < 0) || (id >= CAPACITY))
+        throw std::length_error("Dataref id out of table capacity.");
+    auto &chunk = chunks[id >> CHUNK_BITS];
+    if (chunk.load(std::memory_order_relaxed) == nullptr)
+        chunk.store(new Chunk{}, std::memory_order_release);
+}
@@ -0,0 +1,182 @@
+#ifndef DATAREFTABLE_HPP
+#define DATAREFTABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+/**
+ * @brief 按 id 稠密存放的 dataref 最新值表
+ * 每个槽位是一个 64 位原子字: 高 32 位为写入时的包序号(0 表示尚未收到), 低 32 位为 float 位模式.
+ * io 线程单写, 读者无锁, 双方互不阻塞. 槽位按块分配, 块一经分配直到析构都不会移动.
+ * 每个 id 另有一个代数: 订阅方分配时加一 (奇数, 等待 io 线程清空槽位), io 线程清空后加一 (偶数, 可用),
+ * 释放时进到下一个偶数. 句柄记下创建时的可用代数, 据此区分尚未清空、可用与已退订或被复用.
+ */
+class DatarefTable {
+    public:
+        static constexpr int32_t CHUNK_BITS{12};
+        static constexpr int32_t CHUNK_SIZE{1 << CHUNK_BITS}; // 每块槽位数 (32KB)
+        static constexpr int32_t CHUNK_COUNT{256}; // 块目录大小
+        static constexpr int32_t CAPACITY{CHUNK_SIZE * CHUNK_COUNT}; // 最大 id 数量
+        using Slot = std::atomic<uint64_t>;
+        using Generation = std::atomic<uint32_t>;
+
+        DatarefTable () = default;
+        ~DatarefTable ();
+        DatarefTable (const DatarefTable &) = delete;
+        DatarefTable &operator= (const DatarefTable &) = delete;
+
+        void reserve (int32_t id);
+        [[nodiscard]] Slot* slot (int32_t id) const noexcept;
+        [[nodiscard]] Slot* chunk (int32_t index) const noexcept;
+        [[nodiscard]] const Generation* generation (int32_t id) const noexcept;
+        void claim (int32_t id) noexcept;
+        void clear (int32_t id) noexcept;
+        void retire (int32_t id) noexcept;
+        [[nodiscard]] std::optional<float> load (int32_t id) const noexcept;
+        void store (int32_t id, float value, uint32_t serial) noexcept;
+        static uint64_t encode (float value, uint32_t serial) noexcept;
+        static float decodeValue (uint64_t word) noexcept;
+        static uint32_t decodeSerial (uint64_t word) noexcept;
+        static uint32_t live (uint32_t generation) noexcept;
+    private:
+        struct alignas(64) Chunk {
+            std::array<Slot, CHUNK_SIZE> slots;
+            std::array<Generation, CHUNK_SIZE> generations; // 与槽位分开存放, 批量写入只触及槽位
+        };
+        std::array<std::atomic<Chunk*>, CHUNK_COUNT> chunks{};
+};
+
+/**
+ * @brief 获取槽位
+ * @param id dataref 索引
+ * @return 槽位, 未分配时为 nullptr
+ */
+inline DatarefTable::Slot* DatarefTable::slot (const int32_t id) const noexcept {
+    if ((id < 0) || (id >= CAPACITY))
+        return nullptr;
+    Chunk* chunk = chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr)
+        return nullptr;
+    return &chunk->slots[id & (CHUNK_SIZE - 1)];
+}
+
+/**
+ * @brief 获取整块槽位, 批量写入时同一块只查一次目录
+ * @param index 块序号, 即 id >> CHUNK_BITS
+ * @return 块内首个槽位, 未分配时为 nullptr
+ */
+inline DatarefTable::Slot* DatarefTable::chunk (const int32_t index) const noexcept {
+    if ((index < 0) || (index >= CHUNK_COUNT))
+        return nullptr;
+    Chunk* target = chunks[index].load(std::memory_order_acquire);
+    return (target == nullptr) ? nullptr : target->slots.data();
+}
+
+/**
+ * @brief 获取 id 的代数
+ * @param id dataref 索引
+ * @return 代数, 未分配时为 nullptr
+ */
+inline const DatarefTable::Generation* DatarefTable::generation (const int32_t id) const noexcept {
+    if ((id < 0) || (id >= CAPACITY))
+        return nullptr;
+    const Chunk* chunk = chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr)
+        return nullptr;
+    return &chunk->generations[id & (CHUNK_SIZE - 1)];
+}
+
+/**
+ * @brief 分配 id 时由订阅方调用, 槽位可能还留着上一个订阅的值, 在 clear 之前读不出; 调用者之间需互斥
+ * @param id dataref 索引, 须已 reserve
+ */
+inline void DatarefTable::claim (const int32_t id) noexcept {
+    chunks[id >> CHUNK_BITS].load(std::memory_order_relaxed)->generations[id & (CHUNK_SIZE - 1)].fetch_add(
+        1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 清空已分配 id 的槽位后将其置为可用, 仅 io 线程调用; 期间已被释放时只清空槽位
+ * @param id dataref 索引
+ */
+inline void DatarefTable::clear (const int32_t id) noexcept {
+    Chunk* chunk = chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    chunk->slots[id & (CHUNK_SIZE - 1)].store(0, std::memory_order_relaxed);
+    Generation &generation = chunk->generations[id & (CHUNK_SIZE - 1)];
+    uint32_t current = generation.load(std::memory_order_relaxed);
+    if ((current & 1) != 0) // 读到可用代数的读者必然看到清空
+        generation.compare_exchange_strong(current, current + 1, std::memory_order_release, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 释放 id 时调用, 使已有句柄失效, 之后复用该 id 的写入不会被旧句柄读到; 调用者之间需互斥
+ * @param id dataref 索引
+ */
+inline void DatarefTable::retire (const int32_t id) noexcept {
+    if ((id < 0) || (id >= CAPACITY))
+        return;
+    Chunk* chunk = chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr)
+        return;
+    Generation &generation = chunk->generations[id & (CHUNK_SIZE - 1)];
+    uint32_t current = generation.load(std::memory_order_relaxed);
+    while (!generation.compare_exchange_weak(current, live(current) + 2, std::memory_order_release,
+                                             std::memory_order_relaxed)) {} // 与 io 线程的 clear 竞争
+}
+
+/**
+ * @brief 读取最新值
+ * @param id dataref 索引
+ * @return 最新值, 未分配或尚未收到时为空
+ */
+inline std::optional<float> DatarefTable::load (const int32_t id) const noexcept {
+    const Slot* target = slot(id);
+    if (target == nullptr)
+        return std::nullopt;
+    if ((generation(id)->load(std::memory_order_acquire) & 1) != 0) // 刚分配, 槽位尚未清空
+        return std::nullopt;
+    const uint64_t word = target->load(std::memory_order_acquire);
+    if (decodeSerial(word) == 0)
+        return std::nullopt;
+    return decodeValue(word);
+}
+
+/**
+ * @brief 写入最新值, 仅 io 线程调用
+ * @param id dataref 索引, 未分配的 id 直接丢弃
+ * @param value 值
+ * @param serial 包序号, 非 0
+ */
+inline void DatarefTable::store (const int32_t id, const float value, const uint32_t serial) noexcept {
+    if (Slot* target = slot(id); target != nullptr)
+        target->store(encode(value, serial), std::memory_order_release);
+}
+
+inline uint64_t DatarefTable::encode (const float value, const uint32_t serial) noexcept {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (static_cast<uint64_t>(serial) << 32) | bits;
+}
+
+inline float DatarefTable::decodeValue (const uint64_t word) noexcept {
+    const auto bits = static_cast<uint32_t>(word);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint32_t DatarefTable::decodeSerial (const uint64_t word) noexcept {
+    return static_cast<uint32_t>(word >> 32);
+}
+
+/**
+ * @brief 代数对应的可用代数, 已可用时为自身, 尚未清空时为清空后的代数
+ */
+inline uint32_t DatarefTable::live (const uint32_t generation) noexcept {
+    return (generation + 1) & ~uint32_t{1};
+}
+
+#endif //DATAREFTABLE_HPP
@@ -0,0 +1,54 @@
+#include "DatarefWatch.hpp"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * @param members 监视的订阅
+ * @param deadband 过滤阈值
+ * @param fire 通过过滤后调用
+ */
+WatchCore::WatchCore (std::vector<DatarefHandle<>> members, const float deadband, Fire fire):
+    members(std::move(members)), deadband(deadband), fire(std::move(fire)), lastValues(this->members.size()) {}
+
+/**
+ * @brief 所有订阅都收到过且有订阅在上次检查后更新时, 按过滤规则决定是否通知, 仅 io 线程调用
+ * 槽位只由 io 线程写入, 检查期间不变
+ */
+void WatchCore::check () {
+    uint32_t newest{0};
+    for (const auto &member : members) {
+        const uint32_t serial = member.serial();
+        if (serial == 0) // 尚不完整或已移除
+            return;
+        if ((newest == 0) || (static_cast<int32_t>(serial - newest) > 0))
+            newest = serial;
+    }
+    if (newest == lastSerial)
+        return;
+    lastSerial = newest;
+    bool pass = !notified || (deadband < 0);
+    for (size_t i = 0; (i < members.size()) && !pass; ++i)
+        pass = passes(lastValues[i], DatarefTable::decodeValue(members[i].slot()->load(std::memory_order_relaxed)),
+                      deadband);
+    if (!pass)
+        return;
+    for (size_t i = 0; i < members.size(); ++i) // 与上次通知的值比较, 缓慢漂移累计超过阈值后也会通知
+        lastValues[i] = DatarefTable::decodeValue(members[i].slot()->load(std::memory_order_relaxed));
+    notified = true;
+    fire(newest);
+}
+
+/**
+ * @brief 新值是否通过过滤
+ * @param last 上次通知的值
+ * @param value 新值
+ * @param deadband 过滤阈值
+ */
+bool WatchCore::passes (const float last, const float value, const float deadband) noexcept {
+    if (deadband < 0)
+        return true;
+    if (deadband == 0)
+        return std::memcmp(&last, &value, sizeof(float)) != 0; // 按位比较, NaN 之间不算变化
+    return std::fabs(value - last) > deadband;
+}
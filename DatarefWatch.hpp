@@ -0,0 +1,47 @@
+#ifndef DATAREFWATCH_HPP
+#define DATAREFWATCH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "DatarefHandle.hpp"
+
+using UpdateCallback = std::function<void (float value, uint32_t serial)>;
+
+/**
+ * @brief 更新通知的非模板部分: 监视一组订阅, 每批数据处理完后由 io 线程检查一次, 任一订阅被移除后不再通知
+ * 过滤规则 deadband < 0 时每次更新都通知, 0 时值有变化才通知, > 0 时任一槽位与上次通知时的值相差超过 deadband 才通知
+ */
+class WatchCore {
+    public:
+        using Fire = std::function<void (uint32_t serial)>; // 在 io 线程上调用, 读出值后执行或投递回调
+
+        WatchCore (std::vector<DatarefHandle<>> members, float deadband, Fire fire);
+        void check ();
+        static bool passes (float last, float value, float deadband) noexcept;
+    private:
+        const std::vector<DatarefHandle<>> members;
+        const float deadband;
+        const Fire fire;
+        std::vector<float> lastValues; // 上次通知时的值, 仅 io 线程使用
+        uint32_t lastSerial{0}; // 仅 io 线程使用
+        bool notified{false};
+};
+
+/**
+ * @brief 更新通知句柄, 用于取消
+ */
+class DatarefWatch {
+    public:
+        DatarefWatch () = default;
+        explicit DatarefWatch (std::shared_ptr<WatchCore> core): core(std::move(core)) {}
+
+        [[nodiscard]] const std::shared_ptr<WatchCore> &handle () const noexcept { return core; }
+        [[nodiscard]] bool valid () const noexcept { return core != nullptr; }
+        explicit operator bool () const noexcept { return valid(); }
+    private:
+        std::shared_ptr<WatchCore> core{};
+};
+
+#endif //DATAREFWATCH_HPP
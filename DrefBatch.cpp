@@ -0,0 +1,100 @@
+#include "DrefBatch.hpp"
+#include "DatarefCatalog.hpp"
+
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @param coalesce 合并模式, 同一目标在一次发送前多次写入只保留最后一次
+ */
+DrefBatch::DrefBatch (const bool coalesce): coalesce(coalesce) {}
+
+/**
+ * @brief 登记写入目标并编码包模板, 重复登记返回同一序号
+ * @param dataRef dataref 名称
+ * @param index 目标为数组时的索引
+ * @return 模板序号
+ */
+size_t DrefBatch::add (const string &dataRef, const int index) {
+    string combineName{(index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef};
+    if (const auto it = slots.find(combineName); it != slots.end())
+        return it->second;
+    if (combineName.size() >= PACKET_SIZE - VALUE_OFFSET - sizeof(float))
+        throw length_error("Dataref name too long for DREF packet.");
+    Packet &packet = templates.emplace_back();
+    packet.fill('\x00');
+    memcpy(packet.data(), "DREF", VALUE_OFFSET); // 含结尾 \0
+    memcpy(packet.data() + VALUE_OFFSET + sizeof(float), combineName.data(), combineName.size());
+    queuedPos.push_back(0);
+    readOnly.push_back(DatarefCatalog::readOnly(dataRef));
+    const size_t slot = templates.size() - 1;
+    slots.emplace(move(combineName), slot);
+    return slot;
+}
+
+/**
+ * @brief 登记整个数组, 各元素模板序号连续
+ * @param dataRef dataref 名称
+ * @param length 数组长度
+ * @return 首元素模板序号
+ */
+size_t DrefBatch::addArray (const string &dataRef, const int length) {
+    if (length <= 0)
+        throw invalid_argument("Array length must be positive.");
+    const size_t first = add(dataRef, 0);
+    for (int i = 1; i < length; ++i)
+        if (add(dataRef, i) != first + i)
+            throw invalid_argument("Array elements already registered separately.");
+    return first;
+}
+
+/**
+ * @brief 写入值, 等待下一次发送
+ * @param slot 模板序号
+ * @param value 值
+ */
+void DrefBatch::set (const size_t slot, const float value) {
+    if (slot >= templates.size())
+        throw out_of_range("DrefBatch slot out of range.");
+    if (coalesce && (queuedPos[slot] != 0)) {
+        queued[queuedPos[slot] - 1].second = value;
+        return;
+    }
+    queued.emplace_back(static_cast<uint32_t>(slot), value);
+    queuedPos[slot] = static_cast<uint32_t>(queued.size());
+}
+
+/**
+ * @brief 写入连续的一组值
+ * @param first 首元素模板序号
+ * @param values 值
+ * @param count 数量
+ */
+void DrefBatch::setArray (const size_t first, const float* values, const size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        set(first + i, values[i]);
+}
+
+/**
+ * @brief 丢弃所有待发送值, 保留模板
+ */
+void DrefBatch::clear () noexcept {
+    for (const auto &item : queued)
+        queuedPos[item.first] = 0;
+    queued.clear();
+}
+
+/**
+ * @brief 待发送包数量
+ */
+size_t DrefBatch::pending () const noexcept {
+    return queued.size();
+}
+
+/**
+ * @brief 已登记目标数量
+ */
+size_t DrefBatch::size () const noexcept {
+    return templates.size();
+}
@@ -0,0 +1,65 @@
+#ifndef DREFBATCH_HPP
+#define DREFBATCH_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 批量写入 dataref
+ * 名称在 add 时编码进 DREF 包模板, 之后每次 set 只记下数值; 交给 XPlaneUdp::setDatarefBatch 时才补上数值并整批入队.
+ * 合并模式下一个发送窗口内同一目标多次写入只发最后一次. 非线程安全, 每个线程各用一个.
+ */
+class DrefBatch {
+    public:
+        static constexpr size_t PACKET_SIZE{509};
+        static constexpr size_t VALUE_OFFSET{5}; // DREF\0 之后为 float 值
+        using Packet = std::array<char, PACKET_SIZE>;
+
+        explicit DrefBatch (bool coalesce = true);
+        size_t add (const std::string &dataRef, int index = -1);
+        size_t addArray (const std::string &dataRef, int length);
+        void set (size_t slot, float value);
+        void setArray (size_t first, const float* values, size_t count);
+        void clear () noexcept;
+        [[nodiscard]] size_t pending () const noexcept;
+        [[nodiscard]] size_t size () const noexcept;
+        template <typename F, typename R>
+        size_t take (F &&send, R &&reject);
+    private:
+        bool coalesce;
+        std::vector<Packet> templates; // 已编码名称的包模板
+        std::vector<uint8_t> readOnly; // 模板序号 -> 编目中标记为只读
+        std::unordered_map<std::string, size_t> slots; // 名称 -> 模板序号
+        std::vector<std::pair<uint32_t, float>> queued; // 待发送 <模板序号, 值>
+        std::vector<uint32_t> queuedPos; // 模板在 queued 中的位置+1, 0 为未排队
+};
+
+/**
+ * @brief 取出所有待发送的包并清空
+ * @param send 回调, 参数为补上数值的完整 DREF 包, 调用返回后即可复用
+ * @param reject 回调, 目标为只读 dataref 时代替 send 调用
+ * @return 包数量, 含只读的
+ */
+template <typename F, typename R>
+size_t DrefBatch::take (F &&send, R &&reject) {
+    for (const auto &[slot, value] : queued) {
+        queuedPos[slot] = 0;
+        if (readOnly[slot]) {
+            reject();
+            continue;
+        }
+        Packet &packet = templates[slot];
+        memcpy(packet.data() + VALUE_OFFSET, &value, sizeof(value));
+        send(packet);
+    }
+    const size_t count = queued.size();
+    queued.clear();
+    return count;
+}
+
+#endif //DREFBATCH_HPP
@@ -0,0 +1,128 @@
+#include "IdAllocator.hpp"
+
+#include <iterator>
+
+using namespace std;
+
+/**
+ * @param block 块大小, 不超过块大小的连续分配不跨块
+ * @param capacity id 上限
+ */
+IdAllocator::IdAllocator (const int32_t block, const int32_t capacity): block(block), capacity(capacity) {}
+
+/**
+ * @brief 分配连续 count 个 id, 先回收到期的隔离 id, 再按地址从低到高找第一个放得下的空闲区间
+ * @param count 数量
+ * @param now 当前时间
+ * @return 首个 id, 超出上限时为 -1
+ */
+int32_t IdAllocator::allocate (const int32_t count, const Clock::time_point now) {
+    if (count <= 0)
+        return -1;
+    reclaim(now);
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        const auto [first, length] = *it;
+        const int32_t start = fit(first, count);
+        if (start + count > first + length)
+            continue;
+        ranges.erase(it); // 切出 [start, start + count), 两侧剩余部分放回
+        if (start > first)
+            ranges.emplace(first, start - first);
+        if (first + length > start + count)
+            ranges.emplace(start + count, first + length - start - count);
+        freeCount -= count;
+        return start;
+    }
+    const int32_t start = fit(next, count);
+    if (start + count > capacity)
+        return -1;
+    insert(next, start - next); // 为不跨块跳过的 id 留给之后的小分配
+    next = start + count;
+    return start;
+}
+
+/**
+ * @brief 释放曾经订阅过的 id, 隔离期满后才可复用
+ * @param first 首个 id
+ * @param count 数量
+ * @param now 当前时间
+ */
+void IdAllocator::release (const int32_t first, const int32_t count, const Clock::time_point now) {
+    if (count <= 0)
+        return;
+    held.push_back({now + QUARANTINE, first, count});
+    heldCount += count;
+}
+
+/**
+ * @brief 立即回收从未向 XPlane 订阅过的 id
+ * @param first 首个 id
+ * @param count 数量
+ */
+void IdAllocator::discard (const int32_t first, const int32_t count) {
+    insert(first, count);
+}
+
+/**
+ * @brief 已分配过的 id 上限, 不小于它的 id 从未分配
+ */
+int32_t IdAllocator::end () const noexcept {
+    return next;
+}
+
+/**
+ * @brief 上限以下可立即复用的 id 数量
+ */
+int32_t IdAllocator::available () const noexcept {
+    return freeCount;
+}
+
+/**
+ * @brief 隔离中的 id 数量
+ */
+int32_t IdAllocator::quarantined () const noexcept {
+    return heldCount;
+}
+
+/**
+ * @brief 把到期的隔离 id 放回空闲区间
+ */
+void IdAllocator::reclaim (const Clock::time_point now) {
+    while (!held.empty() && (held.front().until <= now)) {
+        insert(held.front().first, held.front().count);
+        heldCount -= held.front().count;
+        held.pop_front();
+    }
+}
+
+/**
+ * @brief 放入空闲区间并与相邻区间合并
+ */
+void IdAllocator::insert (int32_t first, int32_t count) {
+    if (count <= 0)
+        return;
+    freeCount += count;
+    auto after = ranges.lower_bound(first);
+    if (after != ranges.begin()) {
+        const auto before = prev(after);
+        if (before->first + before->second == first) {
+            first = before->first;
+            count += before->second;
+            ranges.erase(before);
+        }
+    }
+    if ((after != ranges.end()) && (first + count == after->first)) {
+        count += after->second;
+        ranges.erase(after);
+    }
+    ranges.emplace(first, count);
+}
+
+/**
+ * @brief 从 first 起放置 count 个 id 的位置, 跨块时移到下一块开头; 超过块大小的分配只能跨块
+ */
+int32_t IdAllocator::fit (const int32_t first, const int32_t count) const noexcept {
+    if ((count > block) || (first % block + count <= block))
+        return first;
+    return (first / block + 1) * block;
+}
@@ -0,0 +1,47 @@
+#ifndef IDALLOCATOR_HPP
+#define IDALLOCATOR_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+
+/**
+ * @brief RREF id 分配器: 释放的 id 先隔离一段时间再回收, 优先复用低位空闲区间, 使 id 保持稠密
+ * 连续分配的 id 不跨块 (块大小同值表分块), 数组本名与元素落在同一块内, 解码时不必跨块查找.
+ * 隔离期用于丢弃 XPlane 在退订生效前已发出的旧数据, 期满后同一 id 以新名称订阅会覆盖 XPlane 端的旧订阅
+ */
+class IdAllocator {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr auto QUARANTINE{std::chrono::seconds(1)}; // 释放后到可复用的时间
+
+        IdAllocator (int32_t block, int32_t capacity);
+
+        int32_t allocate (int32_t count, Clock::time_point now = Clock::now());
+        void release (int32_t first, int32_t count, Clock::time_point now = Clock::now());
+        void discard (int32_t first, int32_t count);
+        [[nodiscard]] int32_t end () const noexcept;
+        [[nodiscard]] int32_t available () const noexcept;
+        [[nodiscard]] int32_t quarantined () const noexcept;
+    private:
+        struct Held {
+            Clock::time_point until;
+            int32_t first;
+            int32_t count;
+        };
+
+        const int32_t block;
+        const int32_t capacity;
+        int32_t next{0}; // 从未分配过的最小 id
+        int32_t freeCount{0};
+        int32_t heldCount{0};
+        std::map<int32_t, int32_t> ranges; // 空闲区间 起始 id -> 长度, 相邻区间合并
+        std::deque<Held> held; // 隔离中的 id, 按到期时间排列
+
+        void reclaim (Clock::time_point now);
+        void insert (int32_t first, int32_t count);
+        [[nodiscard]] int32_t fit (int32_t first, int32_t count) const noexcept;
+};
+
+#endif //IDALLOCATOR_HPP
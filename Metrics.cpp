@@ -0,0 +1,48 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+void HistogramSnapshot::record (const uint64_t value) noexcept {
+    ++buckets[min(bucket(value), BUCKETS - 1)];
+    ++count;
+    sum += value;
+    max = std::max(max, value);
+}
+
+double HistogramSnapshot::mean () const noexcept {
+    return (count == 0) ? 0 : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+/**
+ * @brief 分位数, 取所在桶的上界 (不超过最大值)
+ * @param p 0 ~ 1
+ */
+uint64_t HistogramSnapshot::percentile (const double p) const noexcept {
+    if (count == 0)
+        return 0;
+    const auto target = static_cast<uint64_t>(p * static_cast<double>(count));
+    uint64_t seen{0};
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen > target)
+            return (i == 0) ? 0 : std::min(max, (uint64_t{1} << i) - 1);
+    }
+    return max;
+}
+
+/**
+ * @brief 读取快照, 与写入并发时各字段之间可能相差少量样本
+ */
+HistogramSnapshot LogHistogram::snapshot () const noexcept {
+    HistogramSnapshot result;
+    for (size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+        result.buckets[i] = buckets[i].load(memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = sum.load(memory_order_relaxed);
+    result.max = max.load(memory_order_relaxed);
+    return result;
+}
+
@@ -0,0 +1,136 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// 置为 0 时完全去掉统计代码, metrics() 返回全零快照
+#ifndef XPLANEUDP_METRICS
+#define XPLANEUDP_METRICS 1
+#endif
+
+/**
+ * @brief 对数分桶直方图的快照, 第 i 桶 (i > 0) 统计 [2^(i-1), 2^i) 内的样本, 第 0 桶统计 0
+ */
+struct HistogramSnapshot {
+    static constexpr size_t BUCKETS{64};
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+
+    void record (uint64_t value) noexcept;
+    [[nodiscard]] double mean () const noexcept;
+    [[nodiscard]] uint64_t percentile (double p) const noexcept;
+    static size_t bucket (uint64_t value) noexcept;
+};
+
+/**
+ * @brief 对数分桶直方图, 单写多读, 写入为 relaxed 的读-加-存, 不使用原子读改写指令
+ */
+class LogHistogram {
+    public:
+        void record (uint64_t value) noexcept;
+        [[nodiscard]] HistogramSnapshot snapshot () const noexcept;
+    private:
+        std::array<std::atomic<uint64_t>, HistogramSnapshot::BUCKETS> buckets{}; // 样本数由各桶求和得出
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+};
+
+/**
+ * @brief 运行统计快照, 时间单位均为 ns
+ */
+struct MetricsSnapshot {
+    uint64_t datagrams{0}; // 收到的数据报
+    uint64_t bytes{0}; // 收到的字节
+    uint64_t rrefPairs{0}; // RREF 数据对
+    uint64_t unknownPairs{0}; // id 未订阅的 RREF 数据对
+    uint64_t rposFrames{0}; // RPOS 帧
+    uint64_t dataRecords{0}; // DATA 记录
+    uint64_t unknownRecords{0}; // 组序号越界的 DATA 记录
+    uint64_t sends{0}; // 发出的数据报
+    uint64_t sendErrors{0}; // 发送失败
+    uint64_t resubscribes{0}; // 超时后整体重新订阅的次数
+    uint64_t staleResubscribes{0}; // 其余订阅照常更新时单独重新订阅的停更订阅数
+    uint64_t endpointChanges{0}; // 后台发现切换 xp 地址的次数
+    uint64_t neverReceived{0}; // 已订阅但从未收到的 dataref
+    uint64_t agedOut{0}; // 最新值早于时间环的 dataref, 年龄未计入直方图
+    uint64_t idLimit{0}; // 已分配 id 上限, 即值表使用的槽位数
+    uint64_t idsFree{0}; // 上限以下可复用的 id
+    uint64_t idsQuarantined{0}; // 释放后隔离中的 id
+    HistogramSnapshot handlerTime; // 单个数据报的处理耗时
+    HistogramSnapshot interArrival; // 同一 dataref 相邻两次更新的间隔
+    HistogramSnapshot valueAge; // 快照时各 dataref 最新值的年龄
+};
+
+/**
+ * @brief RPOS 预测误差: 每收到一帧, 用之前的帧外推到该帧的接收时间, 与该帧比较
+ * 不受 XPLANEUDP_METRICS 影响; 回放抓包时即为对录制数据的误差
+ */
+struct PredictionErrors {
+    uint64_t frames{0}; // 参与比较的帧, 与上一帧间隔超过外推上限的不计
+    HistogramSnapshot horizontal; // 水平位置误差, mm
+    HistogramSnapshot vertical; // 高度误差, mm
+    HistogramSnapshot heading; // 航向误差, 0.001 度
+    HistogramSnapshot attitude; // 俯仰与横滚误差中的较大者, 0.001 度
+    HistogramSnapshot held; // 不外推直接沿用上一帧时的水平位置误差, mm, 作为对照
+};
+
+/**
+ * @brief XPlaneUdp 的运行统计, io 线程单写, 任意线程读取
+ * 最新值年龄与更新间隔由 XPlaneUdp 的包时间环换算
+ */
+class Metrics {
+    public:
+        /**
+         * @brief 单写计数器累加
+         */
+        static void add (std::atomic<uint64_t> &counter, const uint64_t value = 1) noexcept {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> datagrams{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> rrefPairs{0};
+        std::atomic<uint64_t> unknownPairs{0};
+        std::atomic<uint64_t> rposFrames{0};
+        std::atomic<uint64_t> dataRecords{0};
+        std::atomic<uint64_t> unknownRecords{0};
+        std::atomic<uint64_t> sends{0};
+        std::atomic<uint64_t> sendErrors{0};
+        std::atomic<uint64_t> resubscribes{0};
+        std::atomic<uint64_t> endpointChanges{0};
+        std::atomic<uint64_t> staleResubscribes{0};
+        LogHistogram handlerTime;
+        LogHistogram interArrival;
+};
+
+/**
+ * @brief 样本所在的桶, 即样本的二进制位数
+ */
+inline size_t HistogramSnapshot::bucket (uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+#else
+    size_t bits{0};
+    for (; value != 0; value >>= 1)
+        ++bits;
+    return bits;
+#endif
+}
+
+/**
+ * @brief 记录一个样本, 仅写线程调用
+ */
+inline void LogHistogram::record (const uint64_t value) noexcept {
+    auto &target = buckets[std::min(HistogramSnapshot::bucket(value), HistogramSnapshot::BUCKETS - 1)];
+    target.store(target.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value > max.load(std::memory_order_relaxed))
+        max.store(value, std::memory_order_relaxed);
+}
+
+#endif //METRICS_HPP
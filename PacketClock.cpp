@@ -0,0 +1,33 @@
+#include "PacketClock.hpp"
+
+using namespace std;
+
+PacketClock::PacketClock (): times(new atomic<int64_t>[SIZE]()) {}
+
+/**
+ * @brief 记录包序号的接收时间, 仅 io 线程调用
+ * @param serial 包序号
+ * @param time 接收时间 (steady_clock 计数, ns)
+ */
+void PacketClock::record (const uint32_t serial, const int64_t time) noexcept {
+    atomic_thread_fence(memory_order_release); // 读到新序号的读者必然看到被覆盖的时间
+    times[serial & (SIZE - 1)].store(time, memory_order_relaxed);
+    latest.store(serial, memory_order_release);
+}
+
+/**
+ * @brief 包序号对应的接收时间
+ * @return 序号为 0 或已移出时间环时为空
+ */
+optional<int64_t> PacketClock::time (const uint32_t serial) const noexcept {
+    const auto inWindow = [serial] (const uint32_t newest) {
+        return (serial != 0) && (newest - serial < SIZE - 1); // 留出一个正在被覆盖的位置
+    };
+    if (!inWindow(latest.load(memory_order_acquire)))
+        return nullopt;
+    const int64_t time = times[serial & (SIZE - 1)].load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (!inWindow(latest.load(memory_order_relaxed)))
+        return nullopt;
+    return time;
+}
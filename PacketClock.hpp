@@ -0,0 +1,34 @@
+#ifndef PACKETCLOCK_HPP
+#define PACKETCLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+/**
+ * @brief 包序号 -> 接收时间的定长环, io 线程单写, 任意线程读取
+ * dataref 槽位里已有的包序号即可换算出上次更新时间, 不必为每个 dataref 另存时间
+ */
+class PacketClock {
+    public:
+        static constexpr uint32_t SIZE{1 << 16}; // 可换算时间的最近包数
+
+        PacketClock ();
+        void record (uint32_t serial, int64_t time) noexcept;
+        [[nodiscard]] std::optional<int64_t> time (uint32_t serial) const noexcept;
+
+        /**
+         * @brief 包序号对应的接收时间, 仅 io 线程调用, 不必防范并发覆盖
+         */
+        [[nodiscard]] std::optional<int64_t> ownTime (const uint32_t serial) const noexcept {
+            if ((serial == 0) || (latest.load(std::memory_order_relaxed) - serial >= SIZE - 1))
+                return std::nullopt;
+            return times[serial & (SIZE - 1)].load(std::memory_order_relaxed);
+        }
+    private:
+        std::unique_ptr<std::atomic<int64_t>[]> times; // 包序号 & (SIZE - 1) -> 接收时间
+        std::atomic<uint32_t> latest{0}; // 最新包序号
+};
+
+#endif //PACKETCLOCK_HPP
@@ -0,0 +1,49 @@
+#include "PacketRing.hpp"
+
+#include <cerrno>
+
+PacketRing::PacketRing (const size_t slots): slots(slots), lengths(slots, 0) {
+#ifdef __linux__
+    iovecs.resize(slots);
+    headers.resize(slots);
+    for (size_t i = 0; i < slots; ++i) {
+        iovecs[i].iov_base = this->slots[i].data();
+        iovecs[i].iov_len = SLOT_SIZE;
+        headers[i] = {};
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+/**
+ * @brief 非阻塞地取出 socket 中已到达的数据报, 最多填满整个环
+ * @param socket 已就绪的 socket
+ * @return 取到的数据报数量, 通过 packet() 访问, 下一次调用前有效
+ */
+size_t PacketRing::receive (boost::asio::ip::udp::socket &socket) {
+#ifdef __linux__
+    int count;
+    do
+        count = recvmmsg(socket.native_handle(), headers.data(), static_cast<unsigned int>(headers.size()),
+                         MSG_DONTWAIT, nullptr);
+    while ((count < 0) && (errno == EINTR));
+    if (count <= 0)
+        return 0;
+    for (int i = 0; i < count; ++i)
+        lengths[i] = headers[i].msg_len;
+    return static_cast<size_t>(count);
+#else
+    size_t count{0};
+    boost::system::error_code ec;
+    while (count < slots.size()) {
+        if (socket.available(ec) == 0 || ec)
+            break;
+        lengths[count] = socket.receive(boost::asio::buffer(slots[count]), 0, ec);
+        if (ec)
+            break;
+        ++count;
+    }
+    return count;
+#endif
+}
@@ -0,0 +1,50 @@
+#ifndef PACKETRING_HPP
+#define PACKETRING_HPP
+
+#include <array>
+#include <string_view>
+#include <vector>
+#include <boost/asio.hpp>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+/**
+ * @brief 预分配的 UDP 接收环
+ * 一次系统调用尽量取出多个数据报(Linux 下为 recvmmsg), 数据留在槽位中, 通过 string_view 直接解析, 接收路径上无堆分配
+ */
+class PacketRing {
+    public:
+        static constexpr size_t SLOT_SIZE{1472}; // 单个数据报最大长度
+        static constexpr size_t DEFAULT_SLOTS{32};
+        using Slot = std::array<char, SLOT_SIZE>;
+
+        explicit PacketRing (size_t slots = DEFAULT_SLOTS);
+        PacketRing (const PacketRing &) = delete;
+        PacketRing &operator= (const PacketRing &) = delete;
+
+        size_t receive (boost::asio::ip::udp::socket &socket);
+        [[nodiscard]] std::string_view packet (size_t index) const noexcept;
+        [[nodiscard]] size_t capacity () const noexcept;
+    private:
+        std::vector<Slot> slots;
+        std::vector<size_t> lengths;
+#ifdef __linux__
+        std::vector<iovec> iovecs;
+        std::vector<mmsghdr> headers;
+#endif
+};
+
+/**
+ * @brief 获取最近一次接收的第 index 个数据报
+ */
+inline std::string_view PacketRing::packet (const size_t index) const noexcept {
+    return {slots[index].data(), lengths[index]};
+}
+
+inline size_t PacketRing::capacity () const noexcept {
+    return slots.size();
+}
+
+#endif //PACKETRING_HPP
@@ -0,0 +1,210 @@
+#include "PlanePredictor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+constexpr double PI{3.14159265358979323846};
+constexpr double DEG{PI / 180};
+constexpr double WGS84_A{6378137.0}; // 长半轴 m
+constexpr double WGS84_E2{6.69437999014e-3}; // 第一偏心率的平方
+constexpr double STEP{0.01}; // 姿态积分步长 s
+
+/**
+ * @brief 椭球上纬度 lat 高度 alt 处, 纬度与经度每弧度对应的米数
+ */
+static void radii (const double lat, const double alt, double &north, double &east) noexcept {
+    const double s = sin(lat * DEG);
+    const double w = sqrt(1 - WGS84_E2 * s * s);
+    north = WGS84_A * (1 - WGS84_E2) / (w * w * w) + alt; // 子午圈曲率半径
+    east = (WGS84_A / w + alt) * cos(lat * DEG); // 卯酉圈曲率半径在纬圈上的投影
+}
+
+static double wrap180 (const double deg) noexcept {
+    const double wrapped = fmod(deg + 180, 360);
+    return (wrapped < 0 ? wrapped + 360 : wrapped) - 180;
+}
+
+static double wrap360 (const double deg) noexcept {
+    const double wrapped = fmod(deg, 360);
+    return wrapped < 0 ? wrapped + 360 : wrapped;
+}
+
+static uint64_t thousandths (const double value) noexcept {
+    return static_cast<uint64_t>(llround(fabs(value) * 1000));
+}
+
+/**
+ * @brief 位置移动 east/north/up 米, 按中点纬度换算为经纬度
+ */
+static void move (PlaneInfo &info, const double east, const double north, const double up) noexcept {
+    double toNorth, toEast;
+    radii(info.lat, info.alt, toNorth, toEast);
+    radii(info.lat + north / toNorth / DEG / 2, info.alt + up / 2, toNorth, toEast);
+    info.lat += north / toNorth / DEG;
+    info.lon = wrap180(info.lon + east / max(toEast, 1e-6) / DEG);
+    info.alt += up;
+    info.agl = static_cast<float>(info.agl + up);
+}
+
+/**
+ * @brief 记录一帧 RPOS, 先以之前的帧外推到本帧接收时间统计误差
+ * @param info 收到的基本信息
+ * @param time 接收时间
+ */
+void PlanePredictor::record (const PlaneInfo &info, const Clock::time_point time) {
+    if (count == 0) {
+        samples[0] = {info, time};
+        count = 1;
+        return;
+    }
+    const Sample &latest = sample(0);
+    if (time < latest.time) // 时钟不会倒退, 仅防御
+        return;
+    if ((time > latest.time) && (time - latest.time <= MAX_EXTRAPOLATION)) {
+        const PlaneInfo predicted = extrapolate(latest.info, chrono::duration<double>(time - latest.time).count());
+        double east, north;
+        displacement(predicted, info, east, north);
+        errors_.horizontal.record(thousandths(hypot(east, north)));
+        errors_.vertical.record(thousandths(info.alt - predicted.alt));
+        errors_.heading.record(thousandths(wrap180(info.track - predicted.track)));
+        errors_.attitude.record(thousandths(max<double>(fabs(info.pitch - predicted.pitch),
+                                                        fabs(wrap180(info.roll - predicted.roll)))));
+        displacement(latest.info, info, east, north);
+        errors_.held.record(thousandths(hypot(east, north)));
+        ++errors_.frames;
+    }
+    samples[count % HISTORY] = {info, time};
+    ++count;
+}
+
+/**
+ * @brief 某时刻的基本信息: 最新帧之后外推且不超过上限, 相邻两帧之间插值, 早于保留的最早帧时为该帧
+ * @param time 时刻
+ * @return 尚未收到 RPOS 时为空
+ */
+optional<PlaneInfo> PlanePredictor::at (const Clock::time_point time) const {
+    if (count == 0)
+        return nullopt;
+    const Sample &latest = sample(0);
+    if (time >= latest.time)
+        return extrapolate(latest.info, chrono::duration<double>(min<Clock::duration>(
+                               time - latest.time, MAX_EXTRAPOLATION)).count());
+    const size_t kept = min(count, HISTORY);
+    for (size_t age = 1; age < kept; ++age) {
+        const Sample &from = sample(age), &to = sample(age - 1);
+        if (time < from.time)
+            continue;
+        if (to.time <= from.time) // 同一时刻的两帧
+            return to.info;
+        const double interval = chrono::duration<double>(to.time - from.time).count();
+        return interpolate(from.info, to.info, chrono::duration<double>(time - from.time).count() / interval, interval);
+    }
+    return sample(kept - 1).info;
+}
+
+/**
+ * @brief 倒数第 age 帧, 调用者保证 age 小于已保留的帧数
+ */
+const PlanePredictor::Sample &PlanePredictor::sample (const size_t age) const noexcept {
+    return samples[(count - 1 - age) % HISTORY];
+}
+
+/**
+ * @brief 预测误差统计
+ */
+const PredictionErrors &PlanePredictor::errors () const noexcept {
+    return errors_;
+}
+
+/**
+ * @brief 外推: 姿态按机体角速度积分, 水平速度随航向同步转动, 垂直速度不变
+ * @param from 起始帧
+ * @param seconds 外推时长
+ */
+PlaneInfo PlanePredictor::extrapolate (const PlaneInfo &from, const double seconds) {
+    PlaneInfo info = from;
+    if (seconds <= 0)
+        return info;
+    const double p = from.rollRate, q = from.pitchRate, r = from.yawRate;
+    const auto rates = [p, q, r] (const double phi, const double theta, double &dPhi, double &dTheta, double &dPsi) {
+        const double c = max(cos(theta), 1e-3); // 俯仰接近 90 度时欧拉角奇异
+        const double turn = q * sin(phi) + r * cos(phi);
+        dPhi = p + turn * sin(theta) / c;
+        dTheta = q * cos(phi) - r * sin(phi);
+        dPsi = turn / c;
+    };
+    double phi = from.roll * DEG, theta = from.pitch * DEG, psi = from.track * DEG;
+    const int steps = max(1, static_cast<int>(ceil(seconds / STEP)));
+    const double h = seconds / steps;
+    for (int i = 0; i < steps; ++i) { // 中点法
+        double dPhi, dTheta, dPsi;
+        rates(phi, theta, dPhi, dTheta, dPsi);
+        rates(phi + dPhi * h / 2, theta + dTheta * h / 2, dPhi, dTheta, dPsi);
+        phi += dPhi * h;
+        theta += dTheta * h;
+        psi += dPsi * h;
+    }
+    info.roll = static_cast<float>(wrap180(phi / DEG));
+    info.pitch = static_cast<float>(clamp(theta / DEG, -90.0, 90.0));
+    info.track = static_cast<float>(wrap360(psi / DEG));
+    // 定转弯率: 航迹角与航向同步变化
+    const double turn = psi - from.track * DEG; // 不回绕
+    const double vEast = from.vX, vNorth = -from.vZ;
+    const double speed = hypot(vEast, vNorth), course = atan2(vEast, vNorth);
+    double east = vEast * seconds, north = vNorth * seconds;
+    if (fabs(turn) > 1e-9) {
+        const double radius = speed * seconds / turn;
+        east = radius * (cos(course) - cos(course + turn));
+        north = radius * (sin(course + turn) - sin(course));
+    }
+    move(info, east, north, from.vY * seconds);
+    info.vX = static_cast<float>(speed * sin(course + turn));
+    info.vZ = static_cast<float>(-speed * cos(course + turn));
+    return info;
+}
+
+/**
+ * @brief 两帧之间插值: 位置用两端速度作三次 Hermite 插值, 角度沿较短方向线性插值
+ * @param from 前一帧
+ * @param to 后一帧
+ * @param fraction 0 为前一帧, 1 为后一帧
+ * @param interval 两帧间隔 s
+ */
+PlaneInfo PlanePredictor::interpolate (const PlaneInfo &from, const PlaneInfo &to, const double fraction,
+                                       const double interval) {
+    const double f = fraction, f2 = f * f, f3 = f2 * f;
+    const double h10 = (f3 - 2 * f2 + f) * interval, h01 = -2 * f3 + 3 * f2, h11 = (f3 - f2) * interval;
+    const auto lerp = [f] (const double a, const double b) { return static_cast<float>(a + (b - a) * f); };
+    double east, north;
+    displacement(from, to, east, north);
+    PlaneInfo info = from;
+    move(info, h10 * from.vX + h01 * east + h11 * to.vX, h10 * -from.vZ + h01 * north + h11 * -to.vZ,
+         h10 * from.vY + h01 * (to.alt - from.alt) + h11 * to.vY);
+    info.agl = lerp(from.agl, to.agl);
+    info.pitch = lerp(from.pitch, to.pitch);
+    info.roll = static_cast<float>(wrap180(from.roll + wrap180(to.roll - from.roll) * f));
+    info.track = static_cast<float>(wrap360(from.track + wrap180(to.track - from.track) * f));
+    info.vX = lerp(from.vX, to.vX);
+    info.vY = lerp(from.vY, to.vY);
+    info.vZ = lerp(from.vZ, to.vZ);
+    info.rollRate = lerp(from.rollRate, to.rollRate);
+    info.pitchRate = lerp(from.pitchRate, to.pitchRate);
+    info.yawRate = lerp(from.yawRate, to.yawRate);
+    return info;
+}
+
+/**
+ * @brief 两点间的水平位移, 按中点纬度换算
+ * @param from 起点
+ * @param to 终点
+ * @param east 向东的米数
+ * @param north 向北的米数
+ */
+void PlanePredictor::displacement (const PlaneInfo &from, const PlaneInfo &to, double &east, double &north) noexcept {
+    double toNorth, toEast;
+    radii((from.lat + to.lat) / 2, (from.alt + to.alt) / 2, toNorth, toEast);
+    north = (to.lat - from.lat) * DEG * toNorth;
+    east = wrap180(to.lon - from.lon) * DEG * toEast;
+}
@@ -0,0 +1,39 @@
+#ifndef PLANEPREDICTOR_HPP
+#define PLANEPREDICTOR_HPP
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include "XPlaneUDP.hpp"
+
+/**
+ * @brief RPOS 航位推算: 记录最近几帧及接收时间, 相邻两帧之间插值, 最新帧之后按速度与角速度外推
+ * 位置在 WGS84 椭球上换算, 水平速度随航向变化率转动 (定转弯率), 姿态由机体角速度换算为欧拉角速率积分;
+ * 角速度单位 rad/s, 速度为 XPlane 本地坐标 (x 东 y 上 z 南) 的 m/s. 非线程安全, 由调用者加锁
+ */
+class PlanePredictor {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr auto MAX_EXTRAPOLATION{std::chrono::milliseconds(500)}; // 外推上限, 断流后停在此处
+        static constexpr size_t HISTORY{8}; // 保留的帧数, 显示延迟可超过一个 RPOS 周期
+
+        void record (const PlaneInfo &info, Clock::time_point time);
+        [[nodiscard]] std::optional<PlaneInfo> at (Clock::time_point time) const;
+        [[nodiscard]] const PredictionErrors &errors () const noexcept;
+        static PlaneInfo extrapolate (const PlaneInfo &from, double seconds);
+        static PlaneInfo interpolate (const PlaneInfo &from, const PlaneInfo &to, double fraction, double interval);
+        static void displacement (const PlaneInfo &from, const PlaneInfo &to, double &east, double &north) noexcept;
+    private:
+        struct Sample {
+            PlaneInfo info;
+            Clock::time_point time;
+        };
+
+        std::array<Sample, HISTORY> samples{}; // 环形, 按接收时间递增
+        size_t count{0}; // 已记录的帧数
+        PredictionErrors errors_;
+
+        [[nodiscard]] const Sample &sample (size_t age) const noexcept; // 0 为最新帧
+};
+
+#endif //PLANEPREDICTOR_HPP
@@ -0,0 +1,149 @@
+#ifndef RREFDECODER_HPP
+#define RREFDECODER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "DatarefTable.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) // x86-64 必有 SSE2
+#include <emmintrin.h>
+#define RREF_DECODER_SSE2 1
+#else
+#define RREF_DECODER_SSE2 0
+#endif
+
+/**
+ * @brief 按 id 查找槽位, 缓存最近一次命中的块内有效区间 [low, low + span), 区间内只需一次比较和一次加法
+ */
+class SlotCursor {
+    public:
+        SlotCursor (const DatarefTable &table, const int32_t limit): table(table), limit(limit) {}
+
+        DatarefTable::Slot* operator() (const int32_t id) noexcept {
+            if (const uint32_t offset = static_cast<uint32_t>(id) - low; offset < span)
+                return base + offset;
+            return seek(id);
+        }
+
+        [[nodiscard]] uint32_t first () const noexcept { return low; }
+        [[nodiscard]] uint32_t size () const noexcept { return span; }
+        [[nodiscard]] DatarefTable::Slot* slots () const noexcept { return base; }
+    private:
+        const DatarefTable &table;
+        const int32_t limit;
+        uint32_t low{0};
+        uint32_t span{0};
+        DatarefTable::Slot* base{nullptr};
+
+        DatarefTable::Slot* seek (const int32_t id) noexcept {
+            if ((id < 0) || (id >= limit))
+                return nullptr;
+            DatarefTable::Slot* chunk = table.chunk(id >> DatarefTable::CHUNK_BITS);
+            if (chunk == nullptr)
+                return nullptr;
+            base = chunk;
+            low = static_cast<uint32_t>(id) & ~static_cast<uint32_t>(DatarefTable::CHUNK_SIZE - 1);
+            span = std::min<uint32_t>(static_cast<uint32_t>(limit) - low, DatarefTable::CHUNK_SIZE);
+            return base + (static_cast<uint32_t>(id) - low);
+        }
+};
+
+/**
+ * @brief RREF 数据对解码, 逐对读取的参考实现
+ * @param pairs RREF 头部之后的 (int32 id, float 值) 数据对
+ * @param table 值表
+ * @param limit 已分配 id 上限, 不小于它的 id 视为未订阅
+ * @param serial 包序号
+ * @param onStore 写入槽位前以 id 与槽位调用, 可读取旧值
+ * @return 未订阅的数据对数量
+ */
+template <typename F>
+size_t decodeRrefScalar (const std::string_view pairs, DatarefTable &table, const int32_t limit, const uint32_t serial,
+                         F &&onStore) noexcept {
+    SlotCursor cursor(table, limit);
+    size_t unknown{0};
+    for (size_t i = 0; i + 8 <= pairs.size(); i += 8) {
+        int32_t id;
+        uint32_t bits;
+        memcpy(&id, pairs.data() + i, sizeof(id));
+        memcpy(&bits, pairs.data() + i + 4, sizeof(bits));
+        DatarefTable::Slot* slot = cursor(id);
+        if (slot == nullptr) {
+            ++unknown;
+            continue;
+        }
+        onStore(id, *slot);
+        slot->store((static_cast<uint64_t>(serial) << 32) | bits, std::memory_order_release);
+    }
+    return unknown;
+}
+
+/**
+ * @brief RREF 数据对解码, 每次处理 4 对: 拆出 id 与值, 批量检查 id 范围, 值与包序号直接拼成槽位字后写入值表
+ * 不支持 SSE2 时退回逐对实现, 两者对值表的写入逐字节相同
+ * @return 未订阅的数据对数量
+ */
+template <typename F>
+size_t decodeRref (const std::string_view pairs, DatarefTable &table, const int32_t limit, const uint32_t serial,
+                   F &&onStore) noexcept {
+#if RREF_DECODER_SSE2
+    const char* data = pairs.data();
+    const size_t blocks = pairs.size() / 32 * 32;
+    const __m128i sign = _mm_set1_epi32(INT32_MIN); // SSE2 只有有符号比较, 两边翻转符号位后比较无符号数
+    const __m128i valueLanes = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i serialLanes = _mm_set_epi32(static_cast<int32_t>(serial), 0, static_cast<int32_t>(serial), 0);
+    SlotCursor cursor(table, limit);
+    __m128i first = _mm_setzero_si128(), span = sign; // 缓存区间, 随 cursor 更新
+    size_t unknown{0};
+    for (size_t i = 0; i < blocks; i += 32) {
+        const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)); // id0 v0 id1 v1
+        const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16)); // id2 v2 id3 v3
+        const __m128i ids = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(head), _mm_castsi128_ps(tail),
+                                                            _MM_SHUFFLE(2, 0, 2, 0)));
+        // 块内偏移 id - first, 四个都落在缓存区间内时直接按偏移写入
+        const __m128i inside = _mm_cmplt_epi32(_mm_xor_si128(_mm_sub_epi32(ids, first), sign), span);
+        // 交换 id 与值的位置, 再把 id 换成包序号, 得到 (serial << 32 | 值) 的槽位字
+        const __m128i low = _mm_or_si128(_mm_and_si128(_mm_shuffle_epi32(head, _MM_SHUFFLE(2, 3, 0, 1)), valueLanes),
+                                         serialLanes);
+        const __m128i high = _mm_or_si128(_mm_and_si128(_mm_shuffle_epi32(tail, _MM_SHUFFLE(2, 3, 0, 1)), valueLanes),
+                                          serialLanes);
+        if (_mm_movemask_ps(_mm_castsi128_ps(inside)) == 0xF) { // 逐条展开, 槽位字不落回栈上
+            const auto put = [&, base = cursor.slots(), origin = cursor.first()](const size_t at, const __m128i word) {
+                uint32_t id; // id 直接从数据报读取, 比从寄存器逐个取出更快
+                memcpy(&id, data + at, sizeof(id));
+                DatarefTable::Slot &slot = base[id - origin];
+                onStore(static_cast<int32_t>(id), slot);
+                slot.store(static_cast<uint64_t>(_mm_cvtsi128_si64(word)), std::memory_order_release);
+            };
+            put(i, low);
+            put(i + 8, _mm_unpackhi_epi64(low, low));
+            put(i + 16, high);
+            put(i + 24, _mm_unpackhi_epi64(high, high));
+            continue;
+        }
+        alignas(16) uint64_t words[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(words), low);
+        _mm_store_si128(reinterpret_cast<__m128i*>(words + 2), high);
+        for (int k = 0; k < 4; ++k) { // 跨块或含无效 id, 逐个查找
+            int32_t id;
+            memcpy(&id, data + i + 8 * k, sizeof(id));
+            DatarefTable::Slot* slot = cursor(id);
+            if (slot == nullptr) {
+                ++unknown;
+                continue;
+            }
+            onStore(id, *slot);
+            slot->store(words[k], std::memory_order_release);
+        }
+        first = _mm_set1_epi32(static_cast<int32_t>(cursor.first()));
+        span = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(cursor.size())), sign);
+    }
+    return unknown + decodeRrefScalar(pairs.substr(blocks), table, limit, serial, onStore);
+#else
+    return decodeRrefScalar(pairs, table, limit, serial, onStore);
+#endif
+}
+
+#endif //RREFDECODER_HPP
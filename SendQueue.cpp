@@ -0,0 +1,73 @@
+#include "SendQueue.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @param capacity 槽位数, 须为 2 的幂
+ */
+SendQueue::SendQueue (const size_t capacity): cells(capacity), mask(capacity - 1) {
+    if ((capacity < 2) || ((capacity & mask) != 0))
+        throw std::invalid_argument("SendQueue capacity must be a power of two.");
+    for (size_t i = 0; i < capacity; ++i)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 入队一个待发送的包, 可由任意线程调用
+ * @param data 包数据
+ * @param size 包长, 不超过 PACKET_SIZE
+ * @param handler 可选的发送完成回调
+ * @return 队列已满时返回 false
+ */
+bool SendQueue::push (const char* data, const size_t size, SendHandler handler) {
+    if (size > PACKET_SIZE)
+        throw std::length_error("Packet too large for SendQueue.");
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) // 满
+            return false;
+        else
+            pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+    memcpy(cell->packet.data.data(), data, size);
+    cell->packet.size = size;
+    cell->packet.handler = std::move(handler);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief 取得队首连续可读的包, 仅消费者调用, 处理完后须 release
+ * @param out 输出包指针
+ * @param max 最多取出数量
+ * @return 实际数量
+ */
+size_t SendQueue::peek (Packet** out, const size_t max) noexcept {
+    size_t count{0};
+    while (count < max) {
+        Cell &cell = cells[(dequeuePos + count) & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + count + 1)
+            break;
+        out[count++] = &cell.packet;
+    }
+    return count;
+}
+
+/**
+ * @brief 归还 peek 得到的前 count 个槽位
+ */
+void SendQueue::release (const size_t count) noexcept {
+    for (size_t i = 0; i < count; ++i, ++dequeuePos) {
+        Cell &cell = cells[dequeuePos & mask];
+        cell.packet.handler = nullptr;
+        cell.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    }
+}
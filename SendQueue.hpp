@@ -0,0 +1,45 @@
+#ifndef SENDQUEUE_HPP
+#define SENDQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <boost/system/error_code.hpp>
+
+using SendHandler = std::function<void (const boost::system::error_code &)>; // 发送完成回调, 在 io 线程执行
+
+/**
+ * @brief 有界无锁多生产者单消费者发送队列
+ * 任意线程 push 后立即返回, io 线程按批次 peek 出连续的包直接发送, 发送完成后 release 归还槽位, 全程不复制不分配
+ */
+class SendQueue {
+    public:
+        static constexpr size_t PACKET_SIZE{509}; // 最大包长 (DREF)
+        static constexpr size_t DEFAULT_CAPACITY{512};
+        struct Packet {
+            std::array<char, PACKET_SIZE> data;
+            size_t size;
+            SendHandler handler;
+        };
+
+        explicit SendQueue (size_t capacity = DEFAULT_CAPACITY);
+        SendQueue (const SendQueue &) = delete;
+        SendQueue &operator= (const SendQueue &) = delete;
+
+        bool push (const char* data, size_t size, SendHandler handler = nullptr);
+        size_t peek (Packet** out, size_t max) noexcept;
+        void release (size_t count) noexcept;
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            Packet packet;
+        };
+        std::vector<Cell> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> enqueuePos{0};
+        alignas(64) size_t dequeuePos{0}; // 仅消费者使用
+};
+
+#endif //SENDQUEUE_HPP
@@ -0,0 +1,102 @@
+#include "Subscriptions.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief 增加一个使用者
+ * @param name 完整名称, 数组元素带下标
+ * @param id 名称不存在时使用的新 id
+ * @param freq 该使用者需要的频率, 大于 0
+ * @param subscribe 是否向 XPlane 订阅
+ * @return 名称对应的 id; 最高频率提高时附带需要发出的请求
+ */
+SubscriptionTable::Change SubscriptionTable::acquire (const string &name, const int32_t id, const int32_t freq,
+                                                      const bool subscribe) {
+    Change change;
+    auto it = entries.find(name);
+    if (it == entries.end()) {
+        it = entries.emplace(name, Entry{id, {}, 0, subscribe}).first;
+        change.created = true;
+    }
+    Entry &entry = it->second;
+    entry.freqs.insert(freq);
+    change.id = entry.id;
+    if (entry.subscribe && (*entry.freqs.rbegin() != entry.requested)) {
+        entry.requested = *entry.freqs.rbegin();
+        change.request = Request{entry.id, entry.requested, name};
+    }
+    return change;
+}
+
+/**
+ * @brief 移除一个使用者
+ * @param name 完整名称
+ * @param freq 该使用者订阅时的频率, 0 或未找到时移除频率最低的使用者, 不会把请求频率降到其余使用者所需之下
+ * @return 最高频率降低时附带新的请求, 最后一个使用者离开时附带退订
+ */
+SubscriptionTable::Change SubscriptionTable::release (const string &name, const int32_t freq) {
+    Change change;
+    const auto it = entries.find(name);
+    if (it == entries.end())
+        return change;
+    Entry &entry = it->second;
+    change.id = entry.id;
+    auto user = entry.freqs.find(freq);
+    if (user == entry.freqs.end())
+        user = entry.freqs.begin();
+    entry.freqs.erase(user);
+    const int32_t highest = entry.freqs.empty() ? 0 : *entry.freqs.rbegin();
+    if (entry.subscribe && (highest != entry.requested))
+        change.request = Request{entry.id, highest, name};
+    entry.requested = highest;
+    if (entry.freqs.empty()) {
+        entries.erase(it);
+        change.erased = true;
+    }
+    return change;
+}
+
+/**
+ * @brief 名称对应的 id
+ */
+optional<int32_t> SubscriptionTable::find (const string &name) const {
+    const auto it = entries.find(name);
+    if (it == entries.end())
+        return nullopt;
+    return it->second.id;
+}
+
+/**
+ * @brief 名称的使用者数量
+ */
+size_t SubscriptionTable::references (const string &name) const {
+    const auto it = entries.find(name);
+    return (it == entries.end()) ? 0 : it->second.freqs.size();
+}
+
+/**
+ * @brief 当前全部订阅, 按 id 排序, 用于超时后整体重新订阅
+ */
+vector<SubscriptionTable::Request> SubscriptionTable::requests () const {
+    vector<Request> result;
+    result.reserve(entries.size());
+    for (const auto &[name, entry] : entries)
+        if (entry.subscribe)
+            result.push_back({entry.id, entry.requested, name});
+    sort(result.begin(), result.end(), [](const Request &a, const Request &b) { return a.id < b.id; });
+    return result;
+}
+
+/**
+ * @brief 清空订阅表
+ * @return 全部订阅的退订请求
+ */
+vector<SubscriptionTable::Request> SubscriptionTable::clear () {
+    vector<Request> result = requests();
+    for (auto &request : result)
+        request.freq = 0;
+    entries.clear();
+    return result;
+}
@@ -0,0 +1,47 @@
+#ifndef SUBSCRIPTIONS_HPP
+#define SUBSCRIPTIONS_HPP
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief RREF 订阅表: 按名称去重并对使用者计数, 向 XPlane 只请求使用者中的最高频率
+ * 只负责记账, 返回需要发出的 RREF 请求, 加锁与发送由调用方负责
+ */
+class SubscriptionTable {
+    public:
+        struct Request { // 需要发给 XPlane 的 RREF, freq 为 0 时退订
+            int32_t id;
+            int32_t freq;
+            std::string name;
+        };
+
+        struct Change {
+            int32_t id{-1}; // 名称对应的 id, 名称不存在时为 -1
+            bool created{false}; // 新建了名称, 使用了传入的 id
+            bool erased{false}; // 最后一个使用者离开, 名称已删除
+            std::optional<Request> request; // 请求频率有变化时需要发出的 RREF
+        };
+
+        Change acquire (const std::string &name, int32_t id, int32_t freq, bool subscribe = true);
+        Change release (const std::string &name, int32_t freq = 0);
+        [[nodiscard]] std::optional<int32_t> find (const std::string &name) const;
+        [[nodiscard]] size_t references (const std::string &name) const;
+        [[nodiscard]] std::vector<Request> requests () const;
+        std::vector<Request> clear ();
+    private:
+        struct Entry {
+            int32_t id;
+            std::multiset<int32_t> freqs; // 各使用者的频率
+            int32_t requested{0}; // 当前向 XPlane 请求的频率
+            bool subscribe; // 数组本名只计数, 不向 XPlane 订阅
+        };
+
+        std::unordered_map<std::string, Entry> entries;
+};
+
+#endif //SUBSCRIPTIONS_HPP
@@ -0,0 +1,110 @@
+#include "XPlaneCapture.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+namespace bip = boost::interprocess;
+
+constexpr char CAPTURE_MAGIC[8]{'X', 'P', 'U', 'D', 'P', 'C', 'A', 'P'};
+constexpr uint32_t CAPTURE_VERSION{1};
+constexpr size_t FILE_HEADER_SIZE{24};
+constexpr size_t RECORD_HEADER_SIZE{16};
+
+static size_t align8 (const size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+ * @param path 抓包文件路径, 已存在则覆盖
+ */
+CaptureWriter::CaptureWriter (const string &path): file(path, ios::binary | ios::trunc),
+                                                    start(chrono::steady_clock::now()) {
+    if (!file)
+        throw runtime_error("Could not open capture file: " + path);
+    array<char, FILE_HEADER_SIZE> header{};
+    const int64_t wall = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+    memcpy(header.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    memcpy(header.data() + 8, &CAPTURE_VERSION, sizeof(CAPTURE_VERSION));
+    memcpy(header.data() + 16, &wall, sizeof(wall));
+    file.write(header.data(), header.size());
+}
+
+/**
+ * @brief 追加一条记录
+ * @param time 收发时间
+ * @param direction 方向
+ * @param payload 数据报
+ */
+void CaptureWriter::write (const chrono::steady_clock::time_point time, const CaptureDirection direction,
+                           const string_view payload) {
+    array<char, RECORD_HEADER_SIZE + 8> header{}; // 尾部用于补齐
+    const int64_t relative = chrono::duration_cast<chrono::nanoseconds>(time - start).count();
+    const auto length = static_cast<uint32_t>(payload.size());
+    memcpy(header.data(), &relative, sizeof(relative));
+    memcpy(header.data() + 8, &length, sizeof(length));
+    header[12] = static_cast<char>(direction);
+    file.write(header.data(), RECORD_HEADER_SIZE);
+    file.write(payload.data(), static_cast<streamsize>(payload.size()));
+    file.write(header.data() + RECORD_HEADER_SIZE, static_cast<streamsize>(align8(payload.size()) - payload.size()));
+    ++count;
+}
+
+void CaptureWriter::flush () {
+    file.flush();
+}
+
+uint64_t CaptureWriter::records () const noexcept {
+    return count;
+}
+
+/**
+ * @param path 抓包文件路径, 只读映射
+ */
+CaptureReader::CaptureReader (const string &path): mapping(path.c_str(), bip::read_only),
+                                                    region(mapping, bip::read_only) {
+    begin = static_cast<const char*>(region.get_address());
+    size = region.get_size();
+    if ((size < FILE_HEADER_SIZE) || (memcmp(begin, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0))
+        throw runtime_error("Not a capture file: " + path);
+    uint32_t version;
+    memcpy(&version, begin + 8, sizeof(version));
+    if (version != CAPTURE_VERSION)
+        throw runtime_error("Unsupported capture version: " + path);
+    offset = FILE_HEADER_SIZE;
+}
+
+/**
+ * @brief 读出下一条记录, 数据直接指向映射区域
+ * @return 已到末尾或遇到不完整记录时返回 false
+ */
+bool CaptureReader::next (CaptureRecord &record) noexcept {
+    if (offset + RECORD_HEADER_SIZE > size)
+        return false;
+    int64_t relative;
+    uint32_t length;
+    memcpy(&relative, begin + offset, sizeof(relative));
+    memcpy(&length, begin + offset + 8, sizeof(length));
+    if (offset + RECORD_HEADER_SIZE + length > size) // 写入中断的尾部
+        return false;
+    record.time = chrono::nanoseconds{relative};
+    record.direction = static_cast<CaptureDirection>(begin[offset + 12]);
+    record.payload = {begin + offset + RECORD_HEADER_SIZE, length};
+    offset += RECORD_HEADER_SIZE + align8(length);
+    return true;
+}
+
+void CaptureReader::rewind () noexcept {
+    offset = FILE_HEADER_SIZE;
+}
+
+/**
+ * @brief 抓包开始时的系统时间
+ */
+chrono::system_clock::time_point CaptureReader::startTime () const noexcept {
+    int64_t wall;
+    memcpy(&wall, begin + 16, sizeof(wall));
+    return chrono::system_clock::time_point{chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds{wall})};
+}
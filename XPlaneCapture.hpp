@@ -0,0 +1,55 @@
+#ifndef XPLANECAPTURE_HPP
+#define XPLANECAPTURE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+/**
+ * 抓包文件格式 (小端):
+ * 文件头 24 字节: "XPUDPCAP" | uint32 版本 | uint32 保留 | int64 开始时的系统时间(ns)
+ * 记录: int64 相对开始的时间(ns) | uint32 长度 | uint8 方向 | 3 字节保留 | 数据, 补齐到 8 字节
+ * 只追加写入, 记录按 8 字节对齐, 可直接内存映射读取
+ */
+enum class CaptureDirection : uint8_t { RECEIVE = 0, SEND = 1 };
+
+struct CaptureRecord {
+    std::chrono::nanoseconds time; // 相对开始的时间
+    CaptureDirection direction;
+    std::string_view payload; // 指向映射区域
+};
+
+class CaptureWriter {
+    public:
+        explicit CaptureWriter (const std::string &path);
+        CaptureWriter (const CaptureWriter &) = delete;
+        CaptureWriter &operator= (const CaptureWriter &) = delete;
+
+        void write (std::chrono::steady_clock::time_point time, CaptureDirection direction, std::string_view payload);
+        void flush ();
+        [[nodiscard]] uint64_t records () const noexcept;
+    private:
+        std::ofstream file;
+        std::chrono::steady_clock::time_point start;
+        uint64_t count{0};
+};
+
+class CaptureReader {
+    public:
+        explicit CaptureReader (const std::string &path);
+        bool next (CaptureRecord &record) noexcept;
+        void rewind () noexcept;
+        [[nodiscard]] std::chrono::system_clock::time_point startTime () const noexcept;
+    private:
+        boost::interprocess::file_mapping mapping;
+        boost::interprocess::mapped_region region;
+        const char* begin{nullptr};
+        size_t size{0};
+        size_t offset{0};
+};
+
+#endif //XPLANECAPTURE_HPP
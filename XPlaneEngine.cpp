@@ -0,0 +1,99 @@
+#include "XPlaneEngine.hpp"
+
+using namespace std;
+
+/**
+ * @param threads io 线程数, 不超过实例数时各实例可分别占用一个核
+ * @param discover 是否在后台监听 BECN
+ */
+XPlaneEngine::XPlaneEngine (const size_t threads, const bool discover): work(asio::make_work_guard(io_context)),
+                                                                         beaconSocket(io_context) {
+    if (discover) {
+        XPlaneUdp::joinMulticast(beaconSocket);
+        armDiscovery();
+    }
+    for (size_t i = 0; i < max<size_t>(threads, 1); ++i)
+        this->threads.emplace_back([this] () { io_context.run(); });
+}
+
+XPlaneEngine::~XPlaneEngine () {
+    work.reset();
+    io_context.stop();
+    for (auto &thread : threads)
+        if (thread.joinable())
+            thread.join();
+}
+
+/**
+ * @brief 共享的上下文, 实例的 socket 与定时器在其上运行
+ */
+asio::io_context &XPlaneEngine::context () noexcept {
+    return io_context;
+}
+
+/**
+ * @brief 至今发现的所有 xp, 按地址排序
+ */
+vector<XPlaneInstance> XPlaneEngine::instances () {
+    lock_guard<mutex> lock{foundMutex};
+    vector<XPlaneInstance> result;
+    result.reserve(found.size());
+    for (const auto &item : found)
+        result.push_back(item.second);
+    return result;
+}
+
+/**
+ * @brief 等待发现至少 count 个 xp
+ * @param count 数量
+ * @param deadline 截止时间
+ * @return 截止时已发现的所有 xp, 可能少于 count
+ */
+vector<XPlaneInstance> XPlaneEngine::waitForInstances (const size_t count, const chrono::steady_clock::time_point deadline) {
+    unique_lock<mutex> lock{foundMutex};
+    foundSignal.wait_until(lock, deadline, [this, count] () { return found.size() >= count; });
+    lock.unlock();
+    return instances();
+}
+
+/**
+ * @brief 后台监听 BECN: 记录每个发送者, 并把 BECN 转发给连接该地址的实例
+ */
+void XPlaneEngine::armDiscovery () {
+    beaconSocket.async_receive_from(asio::buffer(beaconBuffer), beaconSender, [this](const sys::error_code &error,
+                                                                                  const size_t bytes) {
+        if (error == asio::error::operation_aborted)
+            return;
+        const auto beacon = error ? nullopt : XPlaneUdp::parseBeacon({beaconBuffer.data(), bytes});
+        if (beacon.has_value() && (beacon->mainVer == 1) && (beacon->minorVer <= 2) && (beacon->software == 1)) {
+            const ip::udp::endpoint endpoint{beaconSender.address(), beacon->port};
+            unique_lock<mutex> lock{foundMutex};
+            const bool added = found.count(endpoint) == 0;
+            found[endpoint] = {endpoint, beacon.value(), chrono::steady_clock::now()};
+            lock.unlock();
+            if (added)
+                foundSignal.notify_all();
+            lock_guard<mutex> attachedLock{attachedMutex}; // 持锁投递, 实例关闭时等待投递的任务执行完
+            for (XPlaneUdp* instance : attached)
+                if (instance->endpoint() == endpoint)
+                    asio::post(instance->strand_, [instance, endpoint] () { instance->handleBeacon(endpoint); });
+        }
+        armDiscovery();
+    });
+}
+
+/**
+ * @brief 登记实例, 开始转发其地址的 BECN
+ */
+void XPlaneEngine::attach (XPlaneUdp* instance) {
+    lock_guard<mutex> lock{attachedMutex};
+    attached.insert(instance);
+}
+
+/**
+ * @brief 注销实例, 返回后不再向其投递
+ */
+void XPlaneEngine::detach (XPlaneUdp* instance) {
+    lock_guard<mutex> lock{attachedMutex};
+    attached.erase(instance);
+}
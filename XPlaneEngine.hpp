@@ -0,0 +1,50 @@
+#ifndef XPLANEENGINE_HPP
+#define XPLANEENGINE_HPP
+
+#include <condition_variable>
+#include <map>
+#include <set>
+#include "XPlaneUDP.hpp"
+
+struct XPlaneInstance { // 发出过 BECN 的 xp
+    ip::udp::endpoint endpoint; // 发送者地址与 BECN 中的接收端口
+    XPlaneBeacon beacon;
+    std::chrono::steady_clock::time_point lastSeen; // 最近一次收到 BECN 的时间
+};
+
+/**
+ * @brief 多个 xp 共用的 io 线程池, 并在后台记录所有发出 BECN 的 xp
+ * 每个 XPlaneUdp (XPlaneEngine &, endpoint) 实例各自的订阅表与值表不变, 处理函数在各自的 strand 上串行,
+ * 不同实例在线程池中并行; 实例须先于引擎析构
+ */
+class XPlaneEngine {
+    public:
+        explicit XPlaneEngine (size_t threads = 1, bool discover = true);
+        XPlaneEngine (const XPlaneEngine &) = delete;
+        XPlaneEngine &operator= (const XPlaneEngine &) = delete;
+        ~XPlaneEngine ();
+
+        asio::io_context &context () noexcept;
+        std::vector<XPlaneInstance> instances ();
+        std::vector<XPlaneInstance> waitForInstances (size_t count, std::chrono::steady_clock::time_point deadline);
+    private:
+        friend class XPlaneUdp; // 实例连接与关闭时登记
+
+        asio::io_context io_context{};
+        asio::executor_work_guard<asio::io_context::executor_type> work; // 无实例时线程池也不退出
+        ip::udp::socket beaconSocket;
+        UdpBuffer beaconBuffer{};
+        ip::udp::endpoint beaconSender{};
+        std::map<ip::udp::endpoint, XPlaneInstance> found; // 发现的 xp, 按地址
+        std::set<XPlaneUdp*> attached; // 已连接的实例, 转发其地址的 BECN
+        std::vector<std::thread> threads;
+        std::mutex foundMutex; // 锁
+        std::condition_variable foundSignal; // 发现新 xp 时唤醒
+        std::mutex attachedMutex; // 锁
+
+        void armDiscovery ();
+        void attach (XPlaneUdp* instance);
+        void detach (XPlaneUdp* instance);
+};
+
+#endif //XPLANEENGINE_HPP
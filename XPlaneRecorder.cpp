@@ -0,0 +1,710 @@
+#include "XPlaneRecorder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include "XPlaneUDP.hpp"
+
+using namespace std;
+namespace bip = boost::interprocess;
+
+constexpr char RECORD_MAGIC[8]{'X', 'P', 'U', 'D', 'P', 'R', 'E', 'C'};
+constexpr char CHUNK_MAGIC[4]{'C', 'H', 'N', 'K'};
+constexpr uint32_t RECORD_VERSION{1};
+constexpr size_t FILE_HEADER_SIZE{24};
+constexpr size_t CHUNK_HEADER_SIZE{48};
+constexpr size_t DIRECTORY_ENTRY_SIZE{16};
+constexpr size_t RAW_HEADER_SIZE{16}; // 块内原始记录头
+constexpr uint32_t RECORD_PAIRS{0}, RECORD_INFO{1}, RECORD_NAME{2}; // 原始记录类型
+constexpr array<const char*, 13> INFO_NAMES{
+    "rpos/lon", "rpos/lat", "rpos/alt", "rpos/agl", "rpos/pitch", "rpos/track", "rpos/roll",
+    "rpos/vx", "rpos/vy", "rpos/vz", "rpos/roll_rate", "rpos/pitch_rate", "rpos/yaw_rate"
+};
+
+static size_t align8 (const size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+template <typename T>
+static void put (string &out, const size_t offset, const T value) {
+    memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+template <typename T>
+static T get (const char* data) {
+    T value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint64_t zigzag (const int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag (const uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static uint64_t doubleBits (const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief 位流写入, 每个 64 位字内从高位开始
+ */
+class BitWriter {
+    public:
+        explicit BitWriter (vector<uint64_t> &words): words(words) { words.clear(); }
+
+        /**
+         * @brief 写入 value 的低 count 位, count 为 1~64
+         */
+        void write (uint64_t value, const unsigned count) {
+            if (count < 64)
+                value &= (uint64_t{1} << count) - 1;
+            const unsigned used = bits % 64;
+            if (used == 0)
+                words.push_back(0);
+            const unsigned free = 64 - used;
+            if (count <= free) {
+                words.back() |= value << (free - count);
+            } else {
+                words.back() |= value >> (count - free);
+                words.push_back(value << (64 - (count - free)));
+            }
+            bits += count;
+        }
+    private:
+        vector<uint64_t> &words;
+        size_t bits{0};
+};
+
+/**
+ * @brief 位流读取, 越界时失败
+ */
+class BitReader {
+    public:
+        BitReader (const char* data, const size_t words): data(data), limit(words * 64) {}
+
+        bool read (const unsigned count, uint64_t &value) noexcept {
+            if (bit + count > limit)
+                return false;
+            const unsigned used = bit % 64;
+            const auto first = get<uint64_t>(data + bit / 64 * 8);
+            value = (first << used) >> (64 - count);
+            if (count > 64 - used)
+                value |= get<uint64_t>(data + bit / 64 * 8 + 8) >> (64 - (count - (64 - used)));
+            bit += count;
+            return true;
+        }
+    private:
+        const char* data;
+        size_t limit;
+        size_t bit{0};
+};
+
+/**
+ * @brief 二阶差分按大小分 5 档: 0 占 1 位, 其余为档位前缀加 7/12/20/64 位
+ */
+static void writeDelta (BitWriter &out, const int64_t value) {
+    const uint64_t zz = zigzag(value);
+    if (zz == 0) {
+        out.write(0b0, 1);
+    } else if (zz < (uint64_t{1} << 7)) {
+        out.write(0b10, 2);
+        out.write(zz, 7);
+    } else if (zz < (uint64_t{1} << 12)) {
+        out.write(0b110, 3);
+        out.write(zz, 12);
+    } else if (zz < (uint64_t{1} << 20)) {
+        out.write(0b1110, 4);
+        out.write(zz, 20);
+    } else {
+        out.write(0b1111, 4);
+        out.write(zz, 64);
+    }
+}
+
+static bool readDelta (BitReader &in, int64_t &value) noexcept {
+    uint64_t flag, zz = 0;
+    if (!in.read(1, flag))
+        return false;
+    if (flag != 0) {
+        unsigned width = 64;
+        for (const unsigned bucket : {7u, 12u, 20u}) {
+            if (!in.read(1, flag))
+                return false;
+            if (flag == 0) {
+                width = bucket;
+                break;
+            }
+        }
+        if (!in.read(width, zz))
+            return false;
+    }
+    value = unzigzag(zz);
+    return true;
+}
+
+/**
+ * @brief 压缩块内的接收时刻: 首个原样, 之后为二阶差分
+ */
+static void encodeTimes (const vector<int64_t> &times, vector<uint64_t> &words) {
+    BitWriter out(words);
+    out.write(static_cast<uint64_t>(times.front()), 64);
+    int64_t delta = 0;
+    for (size_t i = 1; i < times.size(); ++i) {
+        writeDelta(out, times[i] - times[i - 1] - delta);
+        delta = times[i] - times[i - 1];
+    }
+}
+
+/**
+ * @brief 压缩一列: 首个样本原样, 之后时刻序号为二阶差分 (定频时每样本 1 位), 值与前值异或后只存有效位
+ */
+static void encodeColumn (const vector<pair<uint32_t, double>> &samples, vector<uint64_t> &words) {
+    BitWriter out(words);
+    int64_t event = samples.front().first, delta = 0;
+    uint64_t value = doubleBits(samples.front().second);
+    out.write(static_cast<uint64_t>(event), 32);
+    out.write(value, 64);
+    int leading = -1, trailing = 0; // 上一个有效位窗口, -1 为尚无
+    for (size_t i = 1; i < samples.size(); ++i) {
+        const int64_t nextDelta = samples[i].first - event;
+        writeDelta(out, nextDelta - delta);
+        event = samples[i].first;
+        delta = nextDelta;
+        const uint64_t bits = doubleBits(samples[i].second);
+        const uint64_t xored = bits ^ value;
+        value = bits;
+        if (xored == 0) {
+            out.write(0b0, 1);
+            continue;
+        }
+        const int lead = __builtin_clzll(xored), trail = __builtin_ctzll(xored);
+        if ((leading >= 0) && (lead >= leading) && (trail >= trailing)) { // 落在上一个窗口内
+            out.write(0b10, 2);
+            out.write(xored >> trailing, 64 - leading - trailing);
+        } else {
+            const int meaningful = 64 - lead - trail;
+            out.write(0b11, 2);
+            out.write(lead, 6);
+            out.write(meaningful - 1, 6);
+            out.write(xored >> trail, meaningful);
+            leading = lead;
+            trailing = trail;
+        }
+    }
+}
+
+/**
+ * @param path 记录文件路径, 已存在则覆盖
+ */
+RecordWriter::RecordWriter (const string &path): file(path, ios::binary | ios::trunc),
+                                                  start(chrono::duration_cast<chrono::nanoseconds>(
+                                                      chrono::steady_clock::now().time_since_epoch()).count()) {
+    if (!file)
+        throw runtime_error("Could not open record file: " + path);
+    string header(FILE_HEADER_SIZE, '\0');
+    const int64_t wall = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+    memcpy(header.data(), RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    put(header, 8, RECORD_VERSION);
+    put(header, 16, wall);
+    file.write(header.data(), static_cast<streamsize>(header.size()));
+    file.flush();
+    if (!file)
+        throw runtime_error("Could not write record file: " + path);
+    writer = thread([this] () { run(); });
+}
+
+RecordWriter::~RecordWriter () {
+    try {
+        close();
+    } catch (const exception &) {} // 写入错误只能由显式 close 报告
+}
+
+/**
+ * @brief 订阅名称变化, 与数据报按到达顺序交给后台线程
+ * @param id 新 id, -1 为退订
+ * @param name 完整名称
+ * @param length 数组本名的长度, 本名不收值不记录
+ */
+void RecordWriter::name (const int32_t id, const string &name, const int32_t length) {
+    if (length > 0)
+        return;
+    string payload(4 + name.size(), '\0');
+    put(payload, 0, id);
+    memcpy(payload.data() + 4, name.data(), name.size());
+    append(RECORD_NAME, 0, payload);
+}
+
+/**
+ * @brief 记录一个 RREF 包的全部数据对, 未命名的 id 由后台线程跳过
+ * @param pairs 包头之后的数据对
+ * @param time 接收时间 steady_clock ns
+ */
+void RecordWriter::recordPairs (const string_view pairs, const int64_t time) {
+    append(RECORD_PAIRS, (time - start) / 1000, pairs);
+    seal();
+}
+
+/**
+ * @brief 记录一帧 RPOS
+ * @param info 基本信息
+ * @param time 接收时间 steady_clock ns
+ */
+void RecordWriter::recordInfo (const PlaneInfo &info, const int64_t time) {
+    append(RECORD_INFO, (time - start) / 1000, {reinterpret_cast<const char*>(&info), sizeof(info)});
+    seal();
+}
+
+/**
+ * @brief 写完已交出的块与当前块后停止后台线程, 调用时 io 线程不再使用本对象
+ * @return 已写入的样本数, 写入出错时抛出 runtime_error
+ */
+uint64_t RecordWriter::close () {
+    if (!writer.joinable())
+        return finish();
+    unique_lock<mutex> lock{mutex_};
+    stopping = true;
+    lock.unlock();
+    wake.notify_one();
+    writer.join(); // 退出前写完已交出的块
+    split(*active);
+    if (!times.empty() || !names.empty())
+        writeChunk();
+    active->data.clear();
+    file.flush();
+    failed = failed || !file;
+    return finish();
+}
+
+/**
+ * @brief 写入出错时抛出, 否则返回写入的样本数
+ */
+uint64_t RecordWriter::finish () const {
+    if (failed)
+        throw runtime_error("Record file write failed, samples after the last complete chunk are lost.");
+    return written.load();
+}
+
+/**
+ * @brief 已写入文件的样本数
+ */
+uint64_t RecordWriter::samples () const noexcept {
+    return written.load(memory_order_relaxed);
+}
+
+uint64_t RecordWriter::chunks () const noexcept {
+    return chunkCount.load(memory_order_relaxed);
+}
+
+/**
+ * @brief 追加一条原始记录: int64 时间 us | uint32 类型 | uint32 长度 | 内容
+ */
+void RecordWriter::append (const uint32_t kind, const int64_t time, const string_view payload) {
+    string &data = active->data;
+    const size_t offset = data.size();
+    data.resize(offset + RAW_HEADER_SIZE + payload.size()); // 复用的块已有容量, 不再分配
+    put(data, offset, time);
+    put(data, offset + 8, kind);
+    put(data, offset + 12, static_cast<uint32_t>(payload.size()));
+    memcpy(data.data() + offset + RAW_HEADER_SIZE, payload.data(), payload.size());
+    if (kind == RECORD_NAME)
+        return;
+    if (active->first < 0)
+        active->first = time;
+    active->last = time;
+}
+
+/**
+ * @brief 当前块已满且空闲块可用时交给后台线程, 否则当前块继续增长
+ */
+void RecordWriter::seal () {
+    if ((active->last - active->first < CHUNK_SPAN) && (active->data.size() < CHUNK_BYTES))
+        return;
+    unique_lock<mutex> lock{mutex_};
+    if (sealed || !spare) // 后台线程仍在写上一块
+        return;
+    sealed = move(active);
+    active = move(spare);
+    lock.unlock();
+    wake.notify_one();
+}
+
+/**
+ * @brief 后台线程: 拆分压缩并写入交出的块, 写完后作为空闲块交还
+ */
+void RecordWriter::run () {
+    unique_lock<mutex> lock{mutex_};
+    while (true) {
+        wake.wait(lock, [this] () { return sealed || stopping; });
+        if (!sealed)
+            return;
+        unique_ptr<Chunk> chunk = move(sealed);
+        lock.unlock();
+        split(*chunk);
+        writeChunk();
+        chunk->data.clear(); // 保留容量
+        chunk->first = chunk->last = -1;
+        lock.lock();
+        spare = move(chunk);
+    }
+}
+
+/**
+ * @brief 名称对应的列, 不存在时新建并随本块写出名称
+ */
+int32_t RecordWriter::column (const string &name, const RecordType type) {
+    const auto [it, created] = columnByName.try_emplace(name, static_cast<int32_t>(columnByName.size()));
+    if (created)
+        names.push_back({it->second, {name, type}});
+    return it->second;
+}
+
+/**
+ * @brief 按到达顺序重放原始记录: 名称变化更新 id -> 列, 数据报按列拆开, 同名重新订阅沿用原列
+ */
+void RecordWriter::split (const Chunk &chunk) {
+    const auto sample = [this] (const int32_t column, const double value) {
+        if (static_cast<size_t>(column) >= columns.size())
+            columns.resize(column + 1);
+        columns[column].emplace_back(static_cast<uint32_t>(times.size() - 1), value);
+    };
+    const string &data = chunk.data;
+    for (size_t offset = 0; offset + RAW_HEADER_SIZE <= data.size();) {
+        const auto time = get<int64_t>(data.data() + offset);
+        const auto kind = get<uint32_t>(data.data() + offset + 8);
+        const string_view payload{data.data() + offset + RAW_HEADER_SIZE, get<uint32_t>(data.data() + offset + 12)};
+        offset += RAW_HEADER_SIZE + payload.size();
+        if (kind == RECORD_NAME) {
+            const auto id = get<int32_t>(payload.data());
+            const string name{payload.substr(4)};
+            if (id < 0) {
+                if (const auto it = idByName.find(name); it != idByName.end()) {
+                    if (static_cast<size_t>(it->second) < columnOf.size())
+                        columnOf[it->second] = -1;
+                    idByName.erase(it);
+                }
+                continue;
+            }
+            if (static_cast<size_t>(id) >= columnOf.size())
+                columnOf.resize(id + 1, -1);
+            columnOf[id] = column(name, RecordType::FLOAT);
+            idByName[name] = id;
+            continue;
+        }
+        if (times.empty() || (times.back() != time))
+            times.push_back(time);
+        if (kind == RECORD_INFO) {
+            if (infoColumn < 0) // 各项列号连续
+                for (size_t i = 0; i < INFO_NAMES.size(); ++i) {
+                    const int32_t created = column(INFO_NAMES[i], (i < 3) ? RecordType::DOUBLE : RecordType::FLOAT);
+                    infoColumn = (i == 0) ? created : infoColumn;
+                }
+            PlaneInfo info;
+            memcpy(&info, payload.data(), sizeof(info));
+            const array<double, INFO_NAMES.size()> values{
+                info.lon, info.lat, info.alt, info.agl, info.pitch, info.track, info.roll,
+                info.vX, info.vY, info.vZ, info.rollRate, info.pitchRate, info.yawRate
+            };
+            for (size_t i = 0; i < values.size(); ++i)
+                sample(infoColumn + static_cast<int32_t>(i), values[i]);
+            continue;
+        }
+        const auto known = static_cast<int32_t>(columnOf.size());
+        for (size_t pair = 0; pair + 8 <= payload.size(); pair += 8) {
+            const auto id = get<int32_t>(payload.data() + pair);
+            if ((id >= 0) && (id < known) && (columnOf[id] >= 0))
+                sample(columnOf[id], get<float>(payload.data() + pair + 4));
+        }
+    }
+}
+
+/**
+ * @brief 编码拆好的一块并追加到文件, 之后清空各列 (保留容量)
+ */
+void RecordWriter::writeChunk () {
+    out.assign(CHUNK_HEADER_SIZE, '\0');
+    for (const auto &[column, info] : names) {
+        const size_t offset = out.size();
+        out.resize(offset + 8 + info.name.size());
+        put(out, offset, static_cast<uint32_t>(column));
+        out[offset + 4] = static_cast<char>(info.type);
+        put(out, offset + 6, static_cast<uint16_t>(info.name.size()));
+        memcpy(out.data() + offset + 8, info.name.data(), info.name.size());
+    }
+    out.resize(align8(out.size()));
+    uint32_t used{0};
+    size_t count{0};
+    for (const auto &samples : columns) {
+        used += samples.empty() ? 0 : 1;
+        count += samples.size();
+    }
+    size_t entry = out.size();
+    out.resize(entry + used * DIRECTORY_ENTRY_SIZE);
+    const size_t timeOffset = out.size();
+    if (!times.empty()) {
+        encodeTimes(times, bits);
+        out.resize(timeOffset + bits.size() * 8);
+        memcpy(out.data() + timeOffset, bits.data(), bits.size() * 8);
+    }
+    const size_t timeBytes = out.size() - timeOffset;
+    for (size_t column = 0; column < columns.size(); ++column) {
+        const auto &samples = columns[column];
+        if (samples.empty())
+            continue;
+        encodeColumn(samples, bits);
+        const size_t offset = out.size();
+        out.resize(offset + bits.size() * 8);
+        memcpy(out.data() + offset, bits.data(), bits.size() * 8);
+        put(out, entry, static_cast<uint32_t>(column));
+        put(out, entry + 4, static_cast<uint32_t>(samples.size()));
+        put(out, entry + 8, static_cast<uint32_t>(offset));
+        put(out, entry + 12, static_cast<uint32_t>(bits.size() * 8));
+        entry += DIRECTORY_ENTRY_SIZE;
+    }
+    memcpy(out.data(), CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+    put(out, 4, used);
+    put(out, 8, static_cast<uint64_t>(out.size()));
+    put(out, 16, times.empty() ? int64_t{0} : times.front());
+    put(out, 24, times.empty() ? int64_t{0} : times.back());
+    put(out, 32, static_cast<uint32_t>(names.size()));
+    put(out, 36, static_cast<uint32_t>(times.size()));
+    put(out, 40, static_cast<uint32_t>(timeOffset));
+    put(out, 44, static_cast<uint32_t>(timeBytes));
+    if (!failed) { // 出错后不再写入, 文件停在最后一个完整的块
+        file.write(out.data(), static_cast<streamsize>(out.size()));
+        file.flush(); // 记录中途也可打开已写完的块
+        failed = !file;
+    }
+    if (!failed) {
+        written.fetch_add(count, memory_order_relaxed);
+        chunkCount.fetch_add(1, memory_order_relaxed);
+    }
+    for (auto &samples : columns)
+        samples.clear();
+    times.clear();
+    names.clear();
+}
+
+/**
+ * @param path 记录文件路径, 只读映射; 写入中断的尾部块被忽略
+ */
+RecordReader::RecordReader (const string &path): mapping(path.c_str(), bip::read_only),
+                                                  region(mapping, bip::read_only) {
+    begin = static_cast<const char*>(region.get_address());
+    size = region.get_size();
+    if ((size < FILE_HEADER_SIZE) || (memcmp(begin, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0))
+        throw runtime_error("Not a record file: " + path);
+    if (get<uint32_t>(begin + 8) != RECORD_VERSION)
+        throw runtime_error("Unsupported record version: " + path);
+    for (size_t offset = FILE_HEADER_SIZE; offset + CHUNK_HEADER_SIZE <= size;) {
+        const char* chunk = begin + offset;
+        const auto length = get<uint64_t>(chunk + 8);
+        if ((memcmp(chunk, CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0) || (length < CHUNK_HEADER_SIZE) ||
+            (length > size - offset))
+            break;
+        const auto columns = get<uint32_t>(chunk + 4);
+        const auto names = get<uint32_t>(chunk + 32);
+        size_t position = CHUNK_HEADER_SIZE;
+        bool valid = true;
+        vector<pair<uint32_t, RecordColumn>> added;
+        for (uint32_t i = 0; (i < names) && valid; ++i) {
+            valid = position + 8 <= length;
+            const size_t nameLength = valid ? get<uint16_t>(chunk + position + 6) : 0;
+            valid = valid && (position + 8 + nameLength <= length);
+            if (valid)
+                added.push_back({get<uint32_t>(chunk + position),
+                                 {{chunk + position + 8, nameLength}, static_cast<RecordType>(chunk[position + 4])}});
+            position += 8 + nameLength;
+        }
+        position = align8(position);
+        valid = valid && (position + columns * DIRECTORY_ENTRY_SIZE <= length);
+        for (uint32_t i = 0; (i < columns) && valid; ++i) {
+            const char* entry = chunk + position + i * DIRECTORY_ENTRY_SIZE;
+            valid = (get<uint32_t>(entry + 8) + static_cast<uint64_t>(get<uint32_t>(entry + 12)) <= length);
+        }
+        const auto times = get<uint32_t>(chunk + 40), timeBytes = get<uint32_t>(chunk + 44);
+        valid = valid && (times + static_cast<uint64_t>(timeBytes) <= length);
+        if (!valid)
+            break;
+        for (auto &[column, info] : added) {
+            if (column >= columns_.size())
+                columns_.resize(column + 1);
+            columns_[column] = move(info);
+        }
+        counts.resize(columns_.size());
+        for (uint32_t i = 0; i < columns; ++i) {
+            const char* entry = chunk + position + i * DIRECTORY_ENTRY_SIZE;
+            const auto column = get<uint32_t>(entry);
+            if (column >= counts.size())
+                counts.resize(column + 1);
+            counts[column] += get<uint32_t>(entry + 4);
+        }
+        if (columns > 0) // 只有名称的块不参与时间索引
+            index.push_back({chunk, get<int64_t>(chunk + 16), get<int64_t>(chunk + 24), columns, chunk + position,
+                             get<uint32_t>(chunk + 36), chunk + times, timeBytes / 8});
+        offset += length;
+    }
+}
+
+/**
+ * @brief 全部列, 下标即列号
+ */
+const vector<RecordColumn> &RecordReader::columns () const noexcept {
+    return columns_;
+}
+
+/**
+ * @brief 名称对应的列号
+ * @return 不存在时为 -1
+ */
+int32_t RecordReader::column (const string_view name) const noexcept {
+    for (size_t i = 0; i < columns_.size(); ++i)
+        if (columns_[i].name == name)
+            return static_cast<int32_t>(i);
+    return -1;
+}
+
+/**
+ * @brief 读出一列在时间范围内的样本, 只解码与范围相交的块
+ * @param column 列号
+ * @param from 起始时间 (含), 相对开始
+ * @param to 结束时间 (含), 相对开始
+ * @return 按时间递增的样本
+ */
+vector<RecordSample> RecordReader::read (const int32_t column, const chrono::nanoseconds from,
+                                         const chrono::nanoseconds to) const {
+    vector<RecordSample> result;
+    vector<int64_t> times;
+    if ((column < 0) || (static_cast<size_t>(column) >= counts.size()))
+        return result;
+    const int64_t fromMicros = from.count() / 1000 + ((from.count() % 1000 > 0) ? 1 : 0);
+    const int64_t toMicros = to.count() / 1000;
+    auto chunk = lower_bound(index.begin(), index.end(), fromMicros, [] (const ChunkIndex &item, const int64_t time) {
+        return item.last < time;
+    });
+    for (; (chunk != index.end()) && (chunk->first <= toMicros); ++chunk) {
+        // 列目录按列号递增
+        uint32_t low = 0, high = chunk->columns;
+        while (low < high) {
+            const uint32_t middle = (low + high) / 2;
+            if (get<uint32_t>(chunk->directory + middle * DIRECTORY_ENTRY_SIZE) < static_cast<uint32_t>(column))
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if ((low < chunk->columns) &&
+            (get<uint32_t>(chunk->directory + low * DIRECTORY_ENTRY_SIZE) == static_cast<uint32_t>(column)))
+            decode(*chunk, low, fromMicros, toMicros, times, result);
+    }
+    return result;
+}
+
+vector<RecordSample> RecordReader::read (const string_view name, const chrono::nanoseconds from,
+                                         const chrono::nanoseconds to) const {
+    return read(column(name), from, to);
+}
+
+/**
+ * @brief 一列的样本总数
+ */
+size_t RecordReader::count (const int32_t column) const noexcept {
+    return ((column < 0) || (static_cast<size_t>(column) >= counts.size())) ? 0 : counts[column];
+}
+
+size_t RecordReader::chunks () const noexcept {
+    return index.size();
+}
+
+/**
+ * @brief 首个样本的时间, 相对开始
+ */
+chrono::nanoseconds RecordReader::firstTime () const noexcept {
+    return chrono::microseconds{index.empty() ? 0 : index.front().first};
+}
+
+/**
+ * @brief 末个样本的时间, 相对开始
+ */
+chrono::nanoseconds RecordReader::lastTime () const noexcept {
+    return chrono::microseconds{index.empty() ? 0 : index.back().last};
+}
+
+/**
+ * @brief 记录开始时的系统时间
+ */
+chrono::system_clock::time_point RecordReader::startTime () const noexcept {
+    return chrono::system_clock::time_point{chrono::duration_cast<chrono::system_clock::duration>(
+        chrono::nanoseconds{get<int64_t>(begin + 16)})};
+}
+
+/**
+ * @brief 解码块内一列, 追加范围内的样本
+ * @param chunk 块
+ * @param entry 列目录中的序号
+ * @param from 起始时间 us (含)
+ * @param to 结束时间 us (含)
+ * @param times 接收时刻缓冲
+ * @param out 输出
+ */
+void RecordReader::decode (const ChunkIndex &chunk, const uint32_t entry, const int64_t from, const int64_t to,
+                           vector<int64_t> &times, vector<RecordSample> &out) const {
+    times.clear();
+    BitReader clock(chunk.times, chunk.timeWords);
+    uint64_t raw;
+    if ((chunk.events == 0) || !clock.read(64, raw))
+        return;
+    times.push_back(static_cast<int64_t>(raw));
+    for (int64_t delta = 0, dod; (times.size() < chunk.events) && readDelta(clock, dod);) {
+        delta += dod;
+        times.push_back(times.back() + delta);
+    }
+    const char* item = chunk.directory + entry * DIRECTORY_ENTRY_SIZE;
+    const auto samples = get<uint32_t>(item + 4);
+    BitReader in(chunk.begin + get<uint32_t>(item + 8), get<uint32_t>(item + 12) / 8);
+    uint64_t event, value;
+    if ((samples == 0) || !in.read(32, event) || !in.read(64, value))
+        return;
+    int64_t delta = 0;
+    uint64_t leading = 0, trailing = 0;
+    for (uint32_t i = 0; i < samples; ++i) {
+        if (i > 0) {
+            int64_t dod;
+            uint64_t flag;
+            if (!readDelta(in, dod) || !in.read(1, flag))
+                return;
+            delta += dod;
+            event += delta;
+            if (flag != 0) {
+                uint64_t xored;
+                if (!in.read(1, flag))
+                    return;
+                if (flag != 0) {
+                    uint64_t meaningful;
+                    if (!in.read(6, leading) || !in.read(6, meaningful))
+                        return;
+                    trailing = 64 - leading - (meaningful + 1);
+                }
+                if (!in.read(static_cast<unsigned>(64 - leading - trailing), xored))
+                    return;
+                value ^= xored << trailing;
+            }
+        }
+        if (event >= times.size())
+            return;
+        const int64_t micros = times[event];
+        if (micros > to) // 列内时间递增
+            return;
+        if (micros < from)
+            continue;
+        double sample;
+        memcpy(&sample, &value, sizeof(sample));
+        out.push_back({chrono::microseconds{micros}, sample});
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef XPLANERECORDER_HPP
+#define XPLANERECORDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+struct PlaneInfo;
+
+/**
+ * 飞行记录文件格式 (小端), 按列分块, 只追加写入, 可直接内存映射读取:
+ * 文件头 24 字节: "XPUDPREC" | uint32 版本 | uint32 保留 | int64 开始时的系统时间(ns)
+ * 块头 48 字节: "CHNK" | uint32 列数 | uint64 块长度 | int64 首个接收时刻(us) | int64 末个接收时刻(us) | uint32 名称数
+ *              | uint32 接收时刻数 | uint32 时刻数据偏移(相对块头) | uint32 时刻数据长度
+ * 名称: 本块首次出现的列, 每项 uint32 列号 | uint8 类型 | uint8 保留 | uint16 长度 | 名称, 整体补齐到 8 字节
+ * 列目录: 每列 uint32 列号 | uint32 样本数 | uint32 数据偏移(相对块头) | uint32 数据长度, 按列号递增
+ * 时刻与列数据: 64 位字组成的位流, 块内各列共用一组接收时刻 (首个原样, 之后为二阶差分);
+ * 列中每个样本为接收时刻序号 (二阶差分) 与值 (与前值异或, Gorilla), 首个样本原样存放
+ * 时刻为相对开始的微秒; 值按 double 存放, FLOAT 列由 float 无损转换
+ */
+enum class RecordType : uint8_t { FLOAT = 0, DOUBLE = 1 };
+
+struct RecordColumn {
+    std::string name;
+    RecordType type;
+};
+
+struct RecordSample {
+    std::chrono::nanoseconds time; // 相对开始的时间
+    double value;
+};
+
+/**
+ * @brief 飞行记录写入: io 线程只把数据报与名称变化原样追加到当前块, 块满后与空闲块交换,
+ * 由后台线程按 id 拆成各列并压缩写入文件; 后台线程未写完上一块时当前块继续增长, io 线程不等待也不丢样本
+ * name/recordPairs/recordInfo 仅 io 线程调用, close 在 io 线程不再使用本对象后调用
+ * 写入出错后不再写入, close 抛出 runtime_error; 析构时不报告
+ */
+class RecordWriter {
+    public:
+        static constexpr int64_t CHUNK_SPAN{5000000}; // 每块时间跨度 us, 也是异常退出时最多丢失的时长
+        static constexpr size_t CHUNK_BYTES{1 << 22}; // 每块原始数据上限, 限制内存
+
+        explicit RecordWriter (const std::string &path);
+        ~RecordWriter ();
+        RecordWriter (const RecordWriter &) = delete;
+        RecordWriter &operator= (const RecordWriter &) = delete;
+
+        void name (int32_t id, const std::string &name, int32_t length);
+        void recordPairs (std::string_view pairs, int64_t time);
+        void recordInfo (const PlaneInfo &info, int64_t time);
+        uint64_t close ();
+        [[nodiscard]] uint64_t samples () const noexcept;
+        [[nodiscard]] uint64_t chunks () const noexcept;
+    private:
+        struct Chunk {
+            std::string data; // 原始记录, 按到达顺序
+            int64_t first{-1}, last{-1}; // 首末数据报的接收时间 us
+        };
+
+        std::ofstream file;
+        int64_t start; // 开始时的 steady_clock 时间 ns
+        std::unique_ptr<Chunk> active{std::make_unique<Chunk>()}; // 仅 io 线程使用
+        // 与后台线程交接, 由 mutex_ 保护
+        std::mutex mutex_;
+        std::condition_variable wake;
+        std::unique_ptr<Chunk> sealed; // 待写入
+        std::unique_ptr<Chunk> spare{std::make_unique<Chunk>()}; // 已写完可复用
+        bool stopping{false};
+        std::thread writer;
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> chunkCount{0};
+        // 以下仅后台线程使用, 停止后由 close 使用
+        bool failed{false}; // 写入出错后保持, 由 close 抛出
+        std::vector<int32_t> columnOf; // id -> 列号, -1 为不记录
+        std::unordered_map<std::string, int32_t> columnByName; // 同名重新订阅沿用原列
+        std::unordered_map<std::string, int32_t> idByName;
+        int32_t infoColumn{-1}; // RPOS 各项的首列, 首次收到 RPOS 时分配
+        std::vector<int64_t> times; // 本块接收时刻 us, 同一数据报的样本共用
+        std::vector<std::vector<std::pair<uint32_t, double>>> columns; // 列号 -> 本块 (时刻序号, 值)
+        std::vector<std::pair<int32_t, RecordColumn>> names; // 本块新增的列
+        std::vector<uint64_t> bits; // 编码缓冲
+        std::string out; // 输出缓冲
+
+        void append (uint32_t kind, int64_t time, std::string_view payload);
+        void seal ();
+        void run ();
+        int32_t column (const std::string &name, RecordType type);
+        void split (const Chunk &chunk);
+        void writeChunk ();
+        uint64_t finish () const;
+};
+
+/**
+ * @brief 飞行记录读取: 只读映射, 打开时遍历块头建立时间索引, 按时间范围只解码相交的块
+ */
+class RecordReader {
+    public:
+        explicit RecordReader (const std::string &path);
+
+        [[nodiscard]] const std::vector<RecordColumn> &columns () const noexcept;
+        [[nodiscard]] int32_t column (std::string_view name) const noexcept;
+        [[nodiscard]] std::vector<RecordSample> read (int32_t column, std::chrono::nanoseconds from = {},
+                                                      std::chrono::nanoseconds to = std::chrono::nanoseconds::max()) const;
+        [[nodiscard]] std::vector<RecordSample> read (std::string_view name, std::chrono::nanoseconds from = {},
+                                                      std::chrono::nanoseconds to = std::chrono::nanoseconds::max()) const;
+        [[nodiscard]] size_t count (int32_t column) const noexcept;
+        [[nodiscard]] size_t chunks () const noexcept;
+        [[nodiscard]] std::chrono::nanoseconds firstTime () const noexcept;
+        [[nodiscard]] std::chrono::nanoseconds lastTime () const noexcept;
+        [[nodiscard]] std::chrono::system_clock::time_point startTime () const noexcept;
+    private:
+        struct ChunkIndex {
+            const char* begin;
+            int64_t first, last; // us
+            uint32_t columns;
+            const char* directory;
+            uint32_t events;
+            const char* times;
+            size_t timeWords;
+        };
+
+        boost::interprocess::file_mapping mapping;
+        boost::interprocess::mapped_region region;
+        const char* begin{nullptr};
+        size_t size{0};
+        std::vector<ChunkIndex> index; // 按时间递增
+        std::vector<RecordColumn> columns_; // 列号 -> 列
+        std::vector<size_t> counts; // 列号 -> 样本数
+
+        void decode (const ChunkIndex &chunk, uint32_t entry, int64_t from, int64_t to, std::vector<int64_t> &times,
+                     std::vector<RecordSample> &out) const;
+};
+
+#endif //XPLANERECORDER_HPP
@@ -0,0 +1,358 @@
+#include "XPlaneShared.hpp"
+
+#include <cstring>
+
+using namespace std;
+namespace bip = boost::interprocess;
+using namespace shared_layout;
+
+const static string SHARED_MAGIC{"XPUDPSHM"};
+constexpr auto STALE_TIMEOUT{chrono::milliseconds(3000)}; // 发布者无写入超时, 同 XPlaneUdp
+
+namespace {
+    size_t slotOffset (const uint32_t nameCapacity) {
+        const size_t end = sizeof(Header) + sizeof(Name) * nameCapacity;
+        return (end + 63) / 64 * 64;
+    }
+
+    int64_t steadyNow () {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+/**
+ * @brief 创建共享内存, 同名旧段先删除, 已映射旧段的读者不受影响
+ * @param name 共享内存名称
+ * @param slots 槽位数, 不小于它的 id 不发布
+ * @param names 目录容量
+ */
+SharedPublisher::SharedPublisher (const string &name, const uint32_t slots, const uint32_t names):
+    segmentName(name) {
+    bip::shared_memory_object::remove(name.c_str());
+    segment = bip::shared_memory_object(bip::create_only, name.c_str(), bip::read_write);
+    segment.truncate(static_cast<bip::offset_t>(slotOffset(names) + sizeof(DatarefTable::Slot) * slots));
+    region = bip::mapped_region(segment, bip::read_write);
+    auto* base = static_cast<char*>(region.get_address()); // 新建的段已清零
+    header = new(base) Header{};
+    this->names = reinterpret_cast<Name*>(base + sizeof(Header));
+    this->slots = reinterpret_cast<DatarefTable::Slot*>(base + slotOffset(names)); // 全零即未收到
+    memcpy(header->magic, SHARED_MAGIC.data(), sizeof(header->magic));
+    header->version = VERSION;
+    header->slotCount = slots;
+    header->nameCapacity = names;
+    header->heartbeat.store(steadyNow(), memory_order_relaxed);
+    header->state.store(PUBLISHING, memory_order_release);
+}
+
+SharedPublisher::~SharedPublisher () {
+    header->state.store(STOPPED, memory_order_release);
+    bip::shared_memory_object::remove(segmentName.c_str());
+}
+
+/**
+ * @brief 发布 id 的名称, 原地改写该 id 的目录项; 先清空槽位, 读者查到新名称时读不出上一个订阅的值
+ * @param id dataref 索引
+ * @param name dataref 名称
+ * @param length 数组本名时为数组长度
+ * @return id 超出目录容量或名称过长时返回 false
+ */
+bool SharedPublisher::publishName (const int32_t id, const string &name, const int32_t length) {
+    if ((id < 0) || (static_cast<uint32_t>(id) >= header->nameCapacity) || name.empty() || (name.size() >= NAME_SIZE))
+        return false;
+    if (static_cast<uint32_t>(id) < header->slotCount) // 订阅请求在此之后发出, 新值不会被清掉
+        slots[id].store(0, memory_order_release);
+    unique_lock<mutex> lock{nameMutex};
+    writeName(id, name, length);
+    return true;
+}
+
+/**
+ * @brief 清除退订的 id 的目录项
+ * @param id dataref 索引
+ */
+void SharedPublisher::removeName (const int32_t id) noexcept {
+    if ((id < 0) || (static_cast<uint32_t>(id) >= header->nameCapacity))
+        return;
+    unique_lock<mutex> lock{nameMutex};
+    writeName(id, {}, 0);
+}
+
+/**
+ * @brief 目录容量, 不小于它的 id 无法发布名称
+ */
+uint32_t SharedPublisher::capacity () const noexcept {
+    return header->nameCapacity;
+}
+
+/**
+ * @brief 以顺序锁改写目录项, 调用方持有 nameMutex
+ */
+void SharedPublisher::writeName (const int32_t id, const string_view name, const int32_t length) noexcept {
+    array<uint64_t, NAME_SIZE / 8> words{};
+    memcpy(words.data(), name.data(), name.size());
+    Name &entry = names[id];
+    const uint32_t begin = entry.sequence.load(memory_order_relaxed);
+    entry.sequence.store(begin + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry.length.store(length, memory_order_relaxed);
+    for (size_t k = 0; k < words.size(); ++k)
+        entry.name[k].store(words[k], memory_order_relaxed);
+    entry.sequence.store(begin + 2, memory_order_release);
+    if (static_cast<uint32_t>(id) >= header->names.load(memory_order_relaxed))
+        header->names.store(id + 1, memory_order_release);
+    header->changes.fetch_add(1, memory_order_release);
+}
+
+/**
+ * @brief 清空复用的 id 的槽位, 不带上一个订阅的值, 仅 io 线程调用
+ * @param id dataref 索引
+ */
+void SharedPublisher::clear (const int32_t id) noexcept {
+    if ((id >= 0) && (static_cast<uint32_t>(id) < header->slotCount))
+        slots[id].store(0, memory_order_release);
+}
+
+/**
+ * @brief 镜像 RREF 数据对, 仅 io 线程调用
+ * @param pairs RREF 头部之后的数据对
+ * @param limit 已分配 id 上限
+ * @param serial 包序号
+ */
+void SharedPublisher::publishPairs (const string_view pairs, const int32_t limit, const uint32_t serial) noexcept {
+    const auto bound = static_cast<uint32_t>(min<int64_t>(limit, header->slotCount));
+    for (size_t i = 0; i + 8 <= pairs.size(); i += 8) {
+        uint32_t id, bits;
+        memcpy(&id, pairs.data() + i, sizeof(id));
+        memcpy(&bits, pairs.data() + i + 4, sizeof(bits));
+        if (id < bound) // 负 id 转为无符号后同样越界
+            slots[id].store((static_cast<uint64_t>(serial) << 32) | bits, memory_order_release);
+    }
+}
+
+/**
+ * @brief 以顺序锁发布 RPOS, 仅 io 线程调用
+ */
+void SharedPublisher::publishInfo (const PlaneInfo &info) noexcept {
+    array<uint64_t, sizeof(PlaneInfo) / 8> words;
+    memcpy(words.data(), &info, sizeof(info));
+    const uint32_t begin = header->infoSequence.load(memory_order_relaxed);
+    header->infoSequence.store(begin + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t k = 0; k < words.size(); ++k)
+        header->info[k].store(words[k], memory_order_relaxed);
+    header->infoSequence.store(begin + 2, memory_order_release);
+    const uint32_t serial = header->infoSerial.load(memory_order_relaxed) + 1;
+    header->infoSerial.store((serial == 0) ? 1 : serial, memory_order_release);
+}
+
+/**
+ * @brief 更新心跳, 每批数据后调用一次
+ */
+void SharedPublisher::beat () noexcept {
+    header->heartbeat.store(steadyNow(), memory_order_relaxed);
+}
+
+/**
+ * @brief 以只读方式映射共享内存
+ * @param name 共享内存名称, 不存在或格式不符时抛出 runtime_error
+ */
+SharedReader::SharedReader (const string &name) {
+    try {
+        segment = bip::shared_memory_object(bip::open_only, name.c_str(), bip::read_only);
+        region = bip::mapped_region(segment, bip::read_only);
+    } catch (const bip::interprocess_exception &) {
+        throw runtime_error("Could not open shared memory: " + name);
+    }
+    const auto* base = static_cast<const char*>(region.get_address());
+    header = reinterpret_cast<const Header*>(base);
+    if ((region.get_size() < sizeof(Header)) || (header->state.load(memory_order_acquire) == CREATING) ||
+        (memcmp(header->magic, SHARED_MAGIC.data(), sizeof(header->magic)) != 0))
+        throw runtime_error("Not an XPlaneUdp shared memory: " + name);
+    if (header->version != VERSION)
+        throw runtime_error("Unsupported shared memory version: " + name);
+    if (region.get_size() < slotOffset(header->nameCapacity) + sizeof(DatarefTable::Slot) * header->slotCount)
+        throw runtime_error("Truncated shared memory: " + name);
+    names = reinterpret_cast<const Name*>(base + sizeof(Header));
+    slots = reinterpret_cast<const DatarefTable::Slot*>(base + slotOffset(header->nameCapacity));
+}
+
+/**
+ * @brief 发布者是否在运行并持续收到数据
+ */
+bool SharedReader::getState () const noexcept {
+    return (header->state.load(memory_order_acquire) == PUBLISHING) &&
+           (steadyNow() - header->heartbeat.load(memory_order_relaxed) <
+            chrono::duration_cast<chrono::nanoseconds>(STALE_TIMEOUT).count());
+}
+
+/**
+ * @brief 获取 dataref 句柄, 读取直接加载共享内存中的槽位, 前后各核对一次目录项的顺序锁
+ * @param dataRef dataref 名称
+ * @param index 目标为数组时的索引
+ * @return 发布者未订阅或 id 超出槽位数时为空句柄; 发布者退订后句柄失效, id 复用后不会读到其他 dataref 的值
+ */
+DatarefHandle<> SharedReader::handle (const string &dataRef, const int index) {
+    const auto entry = find((index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef);
+    if (!entry.has_value() || (static_cast<uint32_t>(entry->id) >= header->slotCount))
+        return {};
+    const auto &sequence = names[entry->id].sequence;
+    const DatarefHandle<> created{entry->id, slots + entry->id, &sequence};
+    // 顺序锁单调递增, 创建后仍为同步时的值说明句柄记下的正是查到的名称
+    if (sequence.load(memory_order_acquire) != entry->sequence)
+        return {};
+    return created;
+}
+
+/**
+ * @brief 获取某个 dataref 最新值
+ * @param dataRef dataref 名称
+ * @param index 目标为数组时的索引
+ * @return 最新值
+ */
+optional<float> SharedReader::getDataref (const string &dataRef, const int index) {
+    return handle(dataRef, index).get(); // 经句柄读取, 查找之后 id 易主时为空
+}
+
+/**
+ * @brief 获取某个 dataref 最新值, 不核对 id 是否易主, 长期使用时用 handle
+ * @param id dataref 索引
+ * @return 最新值
+ */
+optional<float> SharedReader::getDataref (const int32_t id) const noexcept {
+    if ((id < 0) || (static_cast<uint32_t>(id) >= header->slotCount))
+        return nullopt;
+    const uint64_t word = slots[id].load(memory_order_acquire);
+    if (DatarefTable::decodeSerial(word) == 0)
+        return nullopt;
+    return DatarefTable::decodeValue(word);
+}
+
+/**
+ * @brief 通过 dataref 名称索引唯一 id
+ * @param dataRef dataref 名称
+ * @param index 目标为数组时的索引
+ * @return 唯一 id
+ */
+optional<int32_t> SharedReader::datarefName2Id (const string &dataRef, const int index) {
+    const auto entry = find((index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef);
+    if (!entry.has_value())
+        return nullopt;
+    return entry->id;
+}
+
+/**
+ * @brief 获取某组 dataref 最新值
+ * @param dataRef dataref 名称
+ * @return 数据组, 任一元素尚未收到时为空
+ */
+optional<vector<float>> SharedReader::getDatarefArray (const string &dataRef) {
+    const auto entry = find(dataRef);
+    if (!entry.has_value() || (entry->length <= 0))
+        return nullopt;
+    vector<float> container(entry->length);
+    for (int32_t i = 0; i < entry->length; ++i) { // 元素与单个订阅共用时 id 不一定连续, 按名称查找
+        const auto value = getDataref(dataRef, i);
+        if (!value.has_value())
+            return nullopt;
+        container[i] = value.value();
+    }
+    return container;
+}
+
+/**
+ * @brief 通过数组名称索引唯一 id
+ * @param dataRef dataref 名称
+ * @return 唯一 id
+ */
+optional<int32_t> SharedReader::datarefArrayName2Id (const string &dataRef) {
+    const auto entry = find(dataRef);
+    if (!entry.has_value() || (entry->length <= 0))
+        return nullopt;
+    return entry->id;
+}
+
+/**
+ * @brief 读取 RPOS, 与写入冲突时重试
+ * @return 发布者尚未收到时为空
+ */
+optional<PlaneInfo> SharedReader::getBasicInfo () const noexcept {
+    if (header->infoSerial.load(memory_order_acquire) == 0)
+        return nullopt;
+    while (true) {
+        const uint32_t begin = header->infoSequence.load(memory_order_acquire);
+        if ((begin & 1) != 0)
+            continue;
+        array<uint64_t, sizeof(PlaneInfo) / 8> words;
+        for (size_t k = 0; k < words.size(); ++k)
+            words[k] = header->info[k].load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (header->infoSequence.load(memory_order_relaxed) == begin) {
+            PlaneInfo info;
+            memcpy(&info, words.data(), sizeof(info));
+            return info;
+        }
+    }
+}
+
+/**
+ * @brief 查找目录项, 目录改写过时先同步
+ * @param name 完整名称
+ * @return 未发布或已退订时为空
+ */
+optional<SharedReader::Entry> SharedReader::find (const string &name) {
+    const uint32_t changes = header->changes.load(memory_order_acquire);
+    shared_lock<shared_mutex> lock{directoryMutex};
+    if (synced != changes) {
+        lock.unlock();
+        unique_lock<shared_mutex> writeLock{directoryMutex};
+        sync(changes);
+        writeLock.unlock();
+        lock.lock();
+    }
+    const auto it = directory.find(name);
+    if (it == directory.end())
+        return nullopt;
+    return it->second;
+}
+
+/**
+ * @brief 重读顺序锁变化的目录项, 调用方持有写锁; 遇到正在改写的项时保留未同步状态, 下次查找重试
+ * @param changes 开始同步前读到的目录改写次数
+ */
+void SharedReader::sync (const uint32_t changes) {
+    if (synced == changes) // 其他线程已同步
+        return;
+    const uint32_t used = min(header->names.load(memory_order_acquire), header->nameCapacity);
+    if (seen.size() < used) {
+        seen.resize(used, 0);
+        nameOf.resize(used);
+    }
+    bool complete{true};
+    array<uint64_t, NAME_SIZE / 8> words{};
+    for (uint32_t id = 0; id < used; ++id) {
+        const Name &entry = names[id];
+        const uint32_t begin = entry.sequence.load(memory_order_acquire);
+        if (begin == seen[id])
+            continue;
+        const int32_t length = entry.length.load(memory_order_relaxed);
+        for (size_t k = 0; k < words.size(); ++k)
+            words[k] = entry.name[k].load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (((begin & 1) != 0) || (entry.sequence.load(memory_order_relaxed) != begin)) {
+            complete = false;
+            continue;
+        }
+        const auto* text = reinterpret_cast<const char*>(words.data());
+        string key{text, strnlen(text, NAME_SIZE)};
+        // 同名可能已由之后的 id 接替, 只删除仍指向本 id 的项
+        const auto current = static_cast<int32_t>(id);
+        if (const auto it = directory.find(nameOf[id]); (it != directory.end()) && (it->second.id == current))
+            directory.erase(it);
+        if (!key.empty())
+            directory[key] = {current, length, begin};
+        nameOf[id] = move(key);
+        seen[id] = begin;
+    }
+    if (complete)
+        synced = changes;
+}
@@ -0,0 +1,122 @@
+#ifndef XPLANESHARED_HPP
+#define XPLANESHARED_HPP
+
+#include <shared_mutex>
+#include <unordered_map>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include "XPlaneUDP.hpp"
+
+/**
+ * 共享内存布局 (本机字节序):
+ * 头部 192 字节: "XPUDPSHM" | uint32 版本 | uint32 槽位数 | uint32 目录容量 | 已用目录项数 | 状态 | 目录变化次数 | 心跳
+ *              | RPOS 顺序锁
+ * 名称目录: 目录容量个 408 字节的项, 下标即 id, uint32 顺序锁 | int32 数组长度 | 400 字节名称, 名称为空表示未订阅;
+ *          订阅与退订原地改写对应 id 的项, 项数不随订阅次数增长; 顺序锁兼作 id 的代数, 读者句柄据此判断 id 是否易主
+ * 槽位: 槽位数个 64 位字, 格式同 DatarefTable (包序号 << 32 | float 位模式), 下标即 id
+ * 发布者单写, 槽位 (含复用 id 时的清空) 与 RPOS 由 io 线程写入, 目录由订阅线程改写; 读者只读映射, 无锁无拷贝
+ */
+namespace shared_layout {
+    constexpr uint32_t VERSION{2};
+    constexpr size_t NAME_SIZE{400}; // 同 RREF 请求中的名称长度
+    enum State : uint32_t { CREATING = 0, PUBLISHING = 1, STOPPED = 2 };
+
+    struct alignas(64) Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t nameCapacity;
+        std::atomic<uint32_t> names; // 已用的目录项数, 即发布过名称的最大 id + 1
+        std::atomic<uint32_t> state;
+        std::atomic<uint32_t> changes; // 目录改写次数, 读者据此判断是否需要同步
+        std::atomic<int64_t> heartbeat; // 最近一次写入时 steady_clock 的 ns
+        alignas(64) std::atomic<uint32_t> infoSequence; // 奇数表示正在写入
+        std::atomic<uint32_t> infoSerial; // RPOS 帧序号, 0 为尚未收到
+        std::array<std::atomic<uint64_t>, sizeof(PlaneInfo) / 8> info;
+    };
+
+    struct Name {
+        std::atomic<uint32_t> sequence; // 奇数表示正在写入
+        std::atomic<int32_t> length; // 数组本名时为数组长度, 否则为 0
+        std::array<std::atomic<uint64_t>, NAME_SIZE / 8> name; // 以 0 结尾, 为空表示未订阅
+    };
+
+    static_assert(sizeof(PlaneInfo) % 8 == 0, "PlaneInfo must be word sized.");
+    static_assert(sizeof(Header) == 192, "Header layout changed.");
+    static_assert(sizeof(Name) == 408, "Name layout changed.");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Slots must be address free.");
+}
+
+/**
+ * @brief 共享内存发布者, 由 XPlaneUdp 持有, 把最新 dataref 值与 RPOS 镜像到命名共享内存, 析构时删除
+ */
+class SharedPublisher {
+    public:
+        SharedPublisher (const std::string &name, uint32_t slots, uint32_t names);
+        ~SharedPublisher ();
+        SharedPublisher (const SharedPublisher &) = delete;
+        SharedPublisher &operator= (const SharedPublisher &) = delete;
+
+        bool publishName (int32_t id, const std::string &name, int32_t length = 0);
+        void removeName (int32_t id) noexcept;
+        [[nodiscard]] uint32_t capacity () const noexcept;
+        void clear (int32_t id) noexcept;
+        void publishPairs (std::string_view pairs, int32_t limit, uint32_t serial) noexcept;
+        void publishInfo (const PlaneInfo &info) noexcept;
+        void beat () noexcept;
+    private:
+        std::string segmentName;
+        boost::interprocess::shared_memory_object segment;
+        boost::interprocess::mapped_region region;
+        shared_layout::Header* header{nullptr};
+        shared_layout::Name* names{nullptr};
+        DatarefTable::Slot* slots{nullptr};
+        std::mutex nameMutex; // 目录改写
+
+        void writeName (int32_t id, std::string_view name, int32_t length) noexcept;
+};
+
+/**
+ * @brief 共享内存读者, 接口同 XPlaneUdp 的读取部分, 不打开 socket
+ * 名称查找用本地缓存, 目录改写后只重读顺序锁变化的项; 值读取直接加载映射中的槽位,
+ * 句柄记下目录项的顺序锁, 发布者退订或复用该 id 后读不出值
+ */
+class SharedReader {
+    public:
+        explicit SharedReader (const std::string &name);
+        SharedReader (const SharedReader &) = delete;
+        SharedReader &operator= (const SharedReader &) = delete;
+
+        bool getState () const noexcept;
+        // dataref
+        DatarefHandle<> handle (const std::string &dataRef, int index = -1);
+        std::optional<float> getDataref (const std::string &dataRef, int index = -1);
+        std::optional<float> getDataref (int32_t id) const noexcept;
+        std::optional<int32_t> datarefName2Id (const std::string &dataRef, int index = -1);
+        std::optional<std::vector<float>> getDatarefArray (const std::string &dataRef);
+        std::optional<int32_t> datarefArrayName2Id (const std::string &dataRef);
+        // 基本信息
+        std::optional<PlaneInfo> getBasicInfo () const noexcept;
+    private:
+        struct Entry {
+            int32_t id;
+            int32_t length;
+            uint32_t sequence; // 同步时目录项的顺序锁
+        };
+
+        boost::interprocess::shared_memory_object segment;
+        boost::interprocess::mapped_region region;
+        const shared_layout::Header* header{nullptr};
+        const shared_layout::Name* names{nullptr};
+        const DatarefTable::Slot* slots{nullptr};
+        std::unordered_map<std::string, Entry> directory; // 名称 -> 目录项
+        std::vector<uint32_t> seen; // id -> 已同步时的顺序锁
+        std::vector<std::string> nameOf; // id -> 已同步的名称
+        uint32_t synced{0}; // 已同步的目录改写次数
+        std::shared_mutex directoryMutex; // 读写锁
+
+        std::optional<Entry> find (const std::string &name);
+        void sync (uint32_t changes);
+};
+
+#endif //XPLANESHARED_HPP
@@ -0,0 +1,404 @@
+#include "XPlaneSim.hpp"
+
+#include <cmath>
+
+using namespace std;
+
+constexpr int HEADER_LENGTH{5};
+constexpr size_t MAX_PAIRS{183}; // 单个 RREF 数据报最多 (1472 - 5) / 8 对
+constexpr size_t MAX_DATA_RECORDS{40}; // 单个 DATA 数据报最多 40 组
+constexpr auto DATA_PERIOD{chrono::milliseconds(50)}; // DATA 输出 20Hz, 实际频率由 XPlane 数据输出设置决定
+constexpr auto TICK_PERIOD{chrono::milliseconds(5)};
+constexpr auto BEACON_PERIOD{chrono::seconds(1)};
+constexpr size_t REPLAY_BURST{256}; // 全速回放时每次处理的记录数, 之间让出给接收
+const static string MULTI_CAST_GROUP{"239.255.1.1"};
+constexpr unsigned short MULTI_CAST_PORT{49707};
+const static string NETWORK_TIME{"sim/network/misc/network_time_sec"};
+
+/**
+ * @param port 监听端口, 0 为系统分配
+ * @param beacon 是否发送 BECN 多播
+ */
+XPlaneSim::XPlaneSim (const unsigned short port, const bool beacon): socket(io_context), beaconSocket(io_context),
+                                                                     tick(io_context), beaconTimer(io_context),
+                                                                     replayTimer(io_context),
+                                                                     start(chrono::steady_clock::now()) {
+    ip::udp::endpoint local(ip::udp::v4(), port);
+    socket.open(local.protocol());
+    socket.set_option(asio::socket_base::receive_buffer_size(1 << 22)); // 订阅突发
+    socket.bind(local);
+    localPort = socket.local_endpoint().port();
+    if (beacon) {
+        beaconSocket.open(ip::udp::v4());
+        beaconSocket.set_option(ip::multicast::enable_loopback(true));
+        armBeacon();
+    }
+    armReceive();
+    armTick();
+    ioThread = thread([this] () { io_context.run(); });
+}
+
+XPlaneSim::~XPlaneSim () {
+    stop();
+}
+
+void XPlaneSim::stop () {
+    io_context.stop();
+    if (ioThread.joinable())
+        ioThread.join();
+    replayActive.store(false);
+}
+
+/**
+ * @brief 设置某个 dataref 的值, 之后的 RREF 都返回该值
+ * @param dataRef dataref 名称, 数组元素带索引
+ * @param value 值
+ */
+void XPlaneSim::setValue (const string &dataRef, const float value) {
+    asio::post(io_context, [this, dataRef, value] () { values[dataRef] = value; });
+}
+
+/**
+ * @brief 设置合成数据的生成函数, 未 setValue 的 dataref 由它给出
+ */
+void XPlaneSim::setGenerator (Generator generator) {
+    asio::post(io_context, [this, generator = move(generator)] () mutable { this->generator = move(generator); });
+}
+
+/**
+ * @brief 模拟重载机模: 丢弃名称以 prefix 开头的订阅, 其余照常发送, 客户端需单独重新订阅
+ * @param prefix 名称前缀
+ */
+void XPlaneSim::forget (const string &prefix) {
+    asio::post(io_context, [this, prefix] () {
+        for (auto it = subs.begin(); it != subs.end();) {
+            if (it->second.name.compare(0, prefix.size(), prefix) == 0) {
+                subscribedIds.erase(it->second.name);
+                it = subs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        subscriptionCount.store(subs.size());
+    });
+}
+
+/**
+ * @brief 回放抓包文件, 客户端连接后开始, 回放期间停止合成数据
+ * @param path 抓包文件
+ * @param speed 回放倍速, 0 为尽可能快
+ */
+void XPlaneSim::replay (const string &path, const double speed) {
+    auto capture = make_unique<CaptureReader>(path);
+    replayActive.store(true);
+    asio::post(io_context, [this, capture = move(capture), speed] () mutable {
+        reader = move(capture);
+        capturedNames.clear();
+        replaySpeed = speed;
+        replayStart = chrono::steady_clock::now();
+        hasPending = false;
+        replayNext();
+    });
+}
+
+bool XPlaneSim::replaying () const noexcept {
+    return replayActive.load();
+}
+
+/**
+ * @brief 当前订阅数
+ */
+size_t XPlaneSim::subscriptions () const noexcept {
+    return subscriptionCount.load();
+}
+
+uint64_t XPlaneSim::sentPackets () const noexcept {
+    return sent.load();
+}
+
+unsigned short XPlaneSim::port () const noexcept {
+    return localPort;
+}
+
+void XPlaneSim::armReceive () {
+    socket.async_receive_from(asio::buffer(receiveBuffer), sender, [this](const sys::error_code &error, const size_t bytes) {
+        if (error == asio::error::operation_aborted)
+            return;
+        if (!error)
+            handleReceive({receiveBuffer.data(), bytes});
+        armReceive();
+    });
+}
+
+void XPlaneSim::armBeacon () {
+    array<char, 64> buffer{};
+    const uint8_t mainVer{1}, minorVer{2};
+    const int32_t software{1}, xpVer{120100};
+    const uint32_t role{1};
+    const size_t length = pack(buffer, 0, string{"BECN", 5}, mainVer, minorVer, software, xpVer, role, localPort,
+                               string{"XPlaneSim", 10});
+    sys::error_code ec;
+    beaconSocket.send_to(asio::buffer(buffer.data(), length),
+                         ip::udp::endpoint(ip::make_address(MULTI_CAST_GROUP), MULTI_CAST_PORT), 0, ec);
+    beaconTimer.expires_after(BEACON_PERIOD);
+    beaconTimer.async_wait([this](const sys::error_code &error) {
+        if (!error)
+            armBeacon();
+    });
+}
+
+/**
+ * @brief 按订阅频率发送合成数据
+ */
+void XPlaneSim::armTick () {
+    tick.expires_after(TICK_PERIOD);
+    tick.async_wait([this](const sys::error_code &error) {
+        if (error)
+            return;
+        const auto now = chrono::steady_clock::now();
+        const double seconds = chrono::duration<double>(now - start).count();
+        if (hasClient && !reader) {
+            vector<pair<int32_t, float>> pairs;
+            for (auto &[id, sub] : subs) {
+                if (sub.due > now)
+                    continue;
+                const auto period = chrono::duration_cast<chrono::steady_clock::duration>(
+                    chrono::duration<double>(1.0 / sub.freq));
+                sub.due = max(sub.due + period, now - period); // 落后太多时不补发
+                float value{0};
+                if (const auto it = values.find(sub.name); it != values.end())
+                    value = it->second;
+                else if (generator)
+                    value = generator(sub.name, seconds);
+                else if (sub.name == NETWORK_TIME)
+                    value = static_cast<float>(seconds);
+                pairs.emplace_back(id, value);
+            }
+            sendPairs(pairs);
+            if ((basicInfoFreq > 0) && (basicInfoDue <= now)) {
+                basicInfoDue = now + chrono::duration_cast<chrono::steady_clock::duration>(
+                                   chrono::duration<double>(1.0 / basicInfoFreq));
+                sendBasicInfo(seconds);
+            }
+            if (!dataGroups.empty() && (dataDue <= now)) {
+                dataDue = max(dataDue + DATA_PERIOD, now - DATA_PERIOD);
+                sendData(seconds);
+            }
+        }
+        armTick();
+    });
+}
+
+/**
+ * @brief 处理客户端请求
+ */
+void XPlaneSim::handleReceive (const string_view received) {
+    if (received.size() < HEADER_LENGTH)
+        return;
+    client = sender;
+    hasClient = true;
+    const string_view head = received.substr(0, 4);
+    if ((head == "RREF") && (received.size() >= 13)) {
+        int32_t freq, id;
+        unpack(received, HEADER_LENGTH, freq, id);
+        const string_view rest = received.substr(13);
+        const string name{rest.substr(0, rest.find('\x00'))};
+        if (freq == 0) {
+            subs.erase(id);
+            if (const auto it = subscribedIds.find(name); it != subscribedIds.end()) {
+                subs.erase(it->second);
+                subscribedIds.erase(it);
+            }
+        } else {
+            if (const auto it = subscribedIds.find(name); (it != subscribedIds.end()) && (it->second != id))
+                subs.erase(it->second); // 同名重新订阅
+            if (const auto it = subs.find(id); (it != subs.end()) && (it->second.name != name))
+                subscribedIds.erase(it->second.name); // 同 id 换名, 覆盖旧订阅
+            subs[id] = {name, freq, chrono::steady_clock::now()};
+            subscribedIds[name] = id;
+        }
+        subscriptionCount.store(subs.size());
+    } else if (head == "RPOS") {
+        const string_view rest = received.substr(HEADER_LENGTH);
+        basicInfoFreq = atoi(string{rest.substr(0, rest.find('\x00'))}.c_str());
+        basicInfoDue = chrono::steady_clock::now();
+    } else if ((head == "DSEL") || (head == "USEL")) {
+        for (size_t i = HEADER_LENGTH; i + 4 <= received.size(); i += 4) {
+            int32_t index;
+            unpack(received, i, index);
+            if (head == "DSEL")
+                dataGroups.insert(index);
+            else
+                dataGroups.erase(index);
+        }
+    } else if ((head == "DREF") && (received.size() >= 9)) {
+        float value;
+        unpack(received, HEADER_LENGTH, value);
+        const string_view rest = received.substr(9);
+        values[string{rest.substr(0, rest.find('\x00'))}] = value;
+    }
+}
+
+/**
+ * @brief 打包并发送 RREF 数据, 超出单个数据报时拆分
+ */
+void XPlaneSim::sendPairs (const vector<pair<int32_t, float>> &pairs) {
+    UdpBuffer buffer{};
+    for (size_t first = 0; first < pairs.size(); first += MAX_PAIRS) {
+        size_t offset = pack(buffer, 0, string{"RREF", 5});
+        for (size_t i = first; i < min(pairs.size(), first + MAX_PAIRS); ++i)
+            offset = pack(buffer, offset, pairs[i].first, pairs[i].second);
+        send({buffer.data(), offset});
+    }
+}
+
+/**
+ * @brief 合成 RPOS: 30N 120E 附近半径 5km 的匀速右转圆周
+ */
+void XPlaneSim::sendBasicInfo (const double seconds) {
+    constexpr double PI{3.14159265358979323846};
+    constexpr double RADIUS{5000}, OMEGA{2 * PI / 120}, LAT{30.0}, LON{120.0}, ALT{1000};
+    constexpr double WGS84_A{6378137.0}, WGS84_E2{6.69437999014e-3};
+    const double w = sqrt(1 - WGS84_E2 * pow(sin(LAT * PI / 180), 2));
+    const double meterPerLat = (WGS84_A * (1 - WGS84_E2) / (w * w * w) + ALT) * PI / 180; // 椭球上每度的米数
+    const double meterPerLon = (WGS84_A / w + ALT) * cos(LAT * PI / 180) * PI / 180;
+    const double theta = OMEGA * seconds;
+    const double east = RADIUS * sin(theta), north = RADIUS * cos(theta);
+    const double vEast = RADIUS * OMEGA * cos(theta), vNorth = -RADIUS * OMEGA * sin(theta);
+    const double bank = atan(RADIUS * OMEGA * OMEGA / 9.80665);
+    PlaneInfo info{};
+    info.lon = LON + east / meterPerLon;
+    info.lat = LAT + north / meterPerLat;
+    info.alt = ALT;
+    info.agl = 990;
+    info.pitch = 0;
+    info.track = static_cast<float>(fmod(atan2(vEast, vNorth) * 180 / PI + 360, 360));
+    info.roll = static_cast<float>(bank * 180 / PI);
+    info.vX = static_cast<float>(vEast);
+    info.vY = 0;
+    info.vZ = static_cast<float>(-vNorth);
+    info.rollRate = 0;
+    info.pitchRate = static_cast<float>(OMEGA * sin(bank));
+    info.yawRate = static_cast<float>(OMEGA * cos(bank));
+    array<char, HEADER_LENGTH + sizeof(PlaneInfo)> buffer{};
+    pack(buffer, 0, string{"RPOS", 5}, info);
+    send({buffer.data(), buffer.size()});
+}
+
+/**
+ * @brief 合成 DATA: 第 k 个值取 "data/<组序号>/<k>" 的 setValue 值或生成器, 默认为 组序号 * 10 + k
+ */
+void XPlaneSim::sendData (const double seconds) {
+    UdpBuffer buffer{};
+    size_t offset{HEADER_LENGTH}, records{0};
+    pack(buffer, 0, string{"DATA*", 5});
+    for (const int32_t index : dataGroups) {
+        offset = pack(buffer, offset, index);
+        for (int k = 0; k < 8; ++k) {
+            const string name = "data/" + to_string(index) + "/" + to_string(k);
+            float value = static_cast<float>(index * 10 + k);
+            if (const auto it = values.find(name); it != values.end())
+                value = it->second;
+            else if (generator)
+                value = generator(name, seconds);
+            offset = pack(buffer, offset, value);
+        }
+        if (++records == MAX_DATA_RECORDS) {
+            send({buffer.data(), offset});
+            offset = HEADER_LENGTH;
+            records = 0;
+        }
+    }
+    if (records > 0)
+        send({buffer.data(), offset});
+}
+
+/**
+ * @brief 回放下一批到期的记录
+ */
+void XPlaneSim::replayNext () {
+    if (!reader)
+        return;
+    const auto now = chrono::steady_clock::now();
+    if (!hasClient) { // 客户端连接后才开始计时
+        replayStart = now;
+        replayTimer.expires_after(TICK_PERIOD);
+        replayTimer.async_wait([this](const sys::error_code &error) {
+            if (!error)
+                replayNext();
+        });
+        return;
+    }
+    for (size_t burst = 0; burst < REPLAY_BURST; ++burst) {
+        if (!hasPending && !(hasPending = reader->next(pending))) { // 回放结束
+            reader.reset();
+            replayActive.store(false);
+            return;
+        }
+        if (replaySpeed > 0) {
+            const auto due = replayStart + chrono::duration_cast<chrono::steady_clock::duration>(
+                                 chrono::duration<double, nano>(static_cast<double>(pending.time.count()) / replaySpeed));
+            if (due > now) {
+                replayTimer.expires_at(due);
+                replayTimer.async_wait([this](const sys::error_code &error) {
+                    if (!error)
+                        replayNext();
+                });
+                return;
+            }
+        }
+        replayRecord(pending);
+        hasPending = false;
+    }
+    asio::post(io_context, [this] () { replayNext(); });
+}
+
+/**
+ * @brief 回放一条记录: 发出的 RREF 订阅用于建立 id -> 名称映射, 收到的 RREF 换成当前客户端的 id 后转发
+ */
+void XPlaneSim::replayRecord (const CaptureRecord &record) {
+    const string_view payload = record.payload;
+    if (payload.size() < HEADER_LENGTH)
+        return;
+    const string_view head = payload.substr(0, 4);
+    if (record.direction == CaptureDirection::SEND) {
+        if ((head == "RREF") && (payload.size() >= 13)) {
+            int32_t freq, id;
+            unpack(payload, HEADER_LENGTH, freq, id);
+            const string_view rest = payload.substr(13);
+            if (freq == 0)
+                capturedNames.erase(id);
+            else
+                capturedNames[id] = string{rest.substr(0, rest.find('\x00'))};
+        }
+        return;
+    }
+    if (head == "RREF") {
+        vector<pair<int32_t, float>> pairs;
+        for (size_t i = HEADER_LENGTH; i + 8 <= payload.size(); i += 8) {
+            int32_t id;
+            float value;
+            unpack(payload, i, id, value);
+            const auto name = capturedNames.find(id);
+            if (name == capturedNames.end())
+                continue;
+            if (const auto target = subscribedIds.find(name->second); target != subscribedIds.end())
+                pairs.emplace_back(target->second, value);
+        }
+        sendPairs(pairs);
+    } else if (head == "RPOS") {
+        if (basicInfoFreq > 0)
+            send(payload);
+    } else if (head == "DATA") {
+        if (!dataGroups.empty())
+            send(payload);
+    } else
+        send(payload);
+}
+
+void XPlaneSim::send (const string_view packet) {
+    sys::error_code ec;
+    socket.send_to(asio::buffer(packet.data(), packet.size()), client, 0, ec);
+    if (!ec)
+        sent.fetch_add(1, memory_order_relaxed);
+}
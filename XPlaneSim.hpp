@@ -0,0 +1,86 @@
+#ifndef XPLANESIM_HPP
+#define XPLANESIM_HPP
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include "XPlaneUDP.hpp"
+#include "XPlaneCapture.hpp"
+
+/**
+ * @brief 本地 XPlane 替身, 用于无模拟器环境下的测试与压测
+ * 周期性发送 BECN 多播, 响应 RREF 订阅/退订, RPOS 请求与 DSEL/USEL 选择, 记录 DREF 写入;
+ * 数据来自合成 (setValue / setGenerator) 或抓包回放, 回放时按名称把抓包中的 id 换成当前客户端的 id
+ */
+class XPlaneSim {
+    public:
+        using Generator = std::function<float (const std::string &dataRef, double seconds)>;
+
+        explicit XPlaneSim (unsigned short port = 49000, bool beacon = true);
+        ~XPlaneSim ();
+        XPlaneSim (const XPlaneSim &) = delete;
+        XPlaneSim &operator= (const XPlaneSim &) = delete;
+
+        void stop ();
+        void setValue (const std::string &dataRef, float value);
+        void setGenerator (Generator generator);
+        void forget (const std::string &prefix);
+        void replay (const std::string &path, double speed = 1.0);
+        [[nodiscard]] bool replaying () const noexcept;
+        [[nodiscard]] size_t subscriptions () const noexcept;
+        [[nodiscard]] uint64_t sentPackets () const noexcept;
+        [[nodiscard]] unsigned short port () const noexcept;
+    private:
+        struct Subscription {
+            std::string name;
+            int32_t freq;
+            std::chrono::steady_clock::time_point due;
+        };
+
+        asio::io_context io_context{};
+        ip::udp::socket socket;
+        ip::udp::socket beaconSocket;
+        asio::steady_timer tick;
+        asio::steady_timer beaconTimer;
+        asio::steady_timer replayTimer;
+        std::thread ioThread;
+        std::chrono::steady_clock::time_point start;
+        unsigned short localPort{0};
+        // 以下仅 io 线程使用
+        UdpBuffer receiveBuffer{};
+        ip::udp::endpoint sender{};
+        ip::udp::endpoint client{};
+        bool hasClient{false};
+        std::unordered_map<int32_t, Subscription> subs; // 客户端 id -> 订阅
+        std::unordered_map<std::string, int32_t> subscribedIds; // 名称 -> 客户端 id
+        std::unordered_map<std::string, float> values; // DREF 写入或 setValue 的值
+        Generator generator{};
+        int32_t basicInfoFreq{0};
+        std::chrono::steady_clock::time_point basicInfoDue{};
+        std::set<int32_t> dataGroups; // DSEL 选择的 DATA 组
+        std::chrono::steady_clock::time_point dataDue{};
+        std::unique_ptr<CaptureReader> reader; // 回放
+        std::unordered_map<int32_t, std::string> capturedNames; // 抓包中的 id -> 名称
+        double replaySpeed{1.0};
+        std::chrono::steady_clock::time_point replayStart{};
+        CaptureRecord pending{};
+        bool hasPending{false};
+        // 状态
+        std::atomic<bool> replayActive{false};
+        std::atomic<size_t> subscriptionCount{0};
+        std::atomic<uint64_t> sent{0};
+
+        void armReceive ();
+        void armTick ();
+        void armBeacon ();
+        void handleReceive (std::string_view received);
+        void sendPairs (const std::vector<std::pair<int32_t, float>> &pairs);
+        void sendBasicInfo (double seconds);
+        void sendData (double seconds);
+        void replayNext ();
+        void replayRecord (const CaptureRecord &record);
+        void send (std::string_view packet);
+};
+
+#endif //XPLANESIM_HPP
@@ -1,4 +1,11 @@
 #include "XPlaneUDP.hpp"
+#include "XPlaneShared.hpp"
+#include "XPlaneEngine.hpp"
+#include "PlanePredictor.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <future>
 
 #ifdef _WIN32
 constexpr bool IS_WIN = true;
@@ -9,24 +16,166 @@ constexpr bool IS_WIN = false;
 using namespace std;
 
 constexpr int HEADER_LENGTH{5}; // 指令头部长度 4字母+1空
+constexpr auto RECEIVE_TIMEOUT{chrono::milliseconds(3000)}; // 无数据超时
+constexpr size_t SEND_BATCH{64}; // 单次批量发送包数
+constexpr size_t RREF_NAME_SIZE{400}; // RREF 请求中的名称长度, 含结尾 \0
 const static string DATAREF_GET_HEAD{'R', 'R', 'E', 'F', '\x00'};
 const static string DATAREF_SET_HEAD{'D', 'R', 'E', 'F', '\x00'};
 const static string BASIC_INFO_HEAD{'R', 'P', 'O', 'S', '\x00'};
 const static string BECON_HEAD{'B', 'E', 'C', 'N', '\x00'};
+const static string DATA_HEAD{'D', 'A', 'T', 'A', '\x00'};
+const static string DATA_SELECT_HEAD{'D', 'S', 'E', 'L', '\x00'};
+const static string DATA_UNSELECT_HEAD{'U', 'S', 'E', 'L', '\x00'};
+
+/**
+ * @brief 将多个包的发送回调合并为一个
+ * @param count 包数量
+ * @param handler 全部发出后执行一次, 带上第一个错误
+ * @return 每个包使用的回调, handler 为空时也为空
+ */
+static SendHandler joinHandler (const size_t count, SendHandler handler) {
+    if (!handler || (count == 0))
+        return nullptr;
+    auto state = make_shared<pair<size_t, sys::error_code>>(count, sys::error_code{});
+    return [state, handler = move(handler)](const sys::error_code &error) {
+        if (error && !state->second)
+            state->second = error;
+        if (--state->first == 0)
+            handler(state->second);
+    };
+}
+
+/**
+ * @brief 依次读出数组元素, 元素与单个订阅共用时 id 不一定连续
+ * @return 任一元素尚未收到时返回 false
+ */
+static bool loadElements (const DatarefTable &table, const vector<int32_t> &ids, float* out) noexcept {
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const auto value = table.load(ids[i]);
+        if (!value.has_value())
+            return false;
+        out[i] = value.value();
+    }
+    return true;
+}
+
+/**
+ * @brief 检查名称能否放入 DREF 包, 上限与异常类型与 DrefBatch::add 相同
+ * @param length 名称长度, 含数组索引
+ */
+static void checkDrefName (const size_t length) {
+    if (length >= DrefBatch::PACKET_SIZE - HEADER_LENGTH - sizeof(float))
+        throw length_error("Dataref name too long for DREF packet.");
+}
+
+/**
+ * @brief 检查名称能否放入 RREF 请求, 订阅前调用
+ * @param length 名称长度, 含数组索引
+ */
+static void checkRrefName (const size_t length) {
+    if (length >= RREF_NAME_SIZE)
+        throw length_error("Dataref name too long for RREF packet.");
+}
 
 
-XPlaneUdp::XPlaneUdp (): localSocket(io_context), strand_(io_context.get_executor()) {
+/**
+ * @brief 读取缓存的 xp 地址, 格式为一行 "地址 端口"
+ */
+static optional<ip::udp::endpoint> loadEndpoint (const string &path) {
+    ifstream file{path};
+    string address;
+    unsigned short port{0};
+    if (!(file >> address >> port) || (port == 0))
+        return nullopt;
+    sys::error_code error;
+    const auto parsed = ip::make_address(address, error);
+    if (error)
+        return nullopt;
+    return ip::udp::endpoint(parsed, port);
+}
+
+static void saveEndpoint (const string &path, const ip::udp::endpoint &endpoint) {
+    ofstream file{path, ios::trunc};
+    file << endpoint.address().to_string() << ' ' << endpoint.port() << endl;
+}
+
+
+XPlaneUdp::XPlaneUdp (): localSocket(io_context), beaconSocket(io_context), watchdog(io_context),
+                         strand_(io_context.get_executor()) {
     // 绑定xplane
     autoUdpFind();
+    hasEndpoint = true;
+    open();
+}
+
+/**
+ * @brief 直接连接已知地址, 不等待 BECN
+ * @param endpoint xp 地址
+ * @param discover 是否在后台监听 BECN, xp 重启后换了地址或端口时自动切换并重新订阅
+ */
+XPlaneUdp::XPlaneUdp (const ip::udp::endpoint &endpoint, const bool discover):
+    localSocket(io_context), beaconSocket(io_context), watchdog(io_context), strand_(io_context.get_executor()) {
+    remoteEndpoint = endpoint;
+    hasEndpoint = true;
+    if (discover)
+        joinMulticast(beaconSocket);
+    open();
+}
+
+/**
+ * @brief 以缓存的上次地址立即启动, 并在后台监听 BECN
+ * 无缓存时不阻塞也不抛出, 订阅先记下, 收到 BECN 后整体发出; 之前的写入丢弃
+ * @param cache 缓存文件路径, 发现新地址时写入
+ */
+XPlaneUdp::XPlaneUdp (const string &cache): localSocket(io_context), beaconSocket(io_context), endpointCache(cache),
+                                            watchdog(io_context), strand_(io_context.get_executor()) {
+    if (const auto cached = loadEndpoint(cache); cached.has_value()) {
+        remoteEndpoint = cached.value();
+        hasEndpoint = true;
+    }
+    joinMulticast(beaconSocket);
+    open();
+}
+
+/**
+ * @brief 在共享线程池上连接已知地址, 不另开 io 线程
+ * 不单独监听 BECN, 由引擎转发本地址的 BECN; 多个 xp 同时在线, 不切换地址
+ * @param engine 共享线程池, 须比本实例存活更久
+ * @param endpoint xp 地址
+ */
+XPlaneUdp::XPlaneUdp (XPlaneEngine &engine, const ip::udp::endpoint &endpoint):
+    ownContext(), io_context(engine.context()), engine(&engine), localSocket(io_context), beaconSocket(io_context),
+    watchdog(io_context), strand_(io_context.get_executor()) {
+    remoteEndpoint = endpoint;
+    hasEndpoint = true;
+    open();
+    engine.attach(this);
+}
+
+/**
+ * @brief 打开本地 socket, 订阅保活 dataref 并启动 io 线程
+ */
+void XPlaneUdp::open () {
     ip::udp::endpoint local(ip::udp::v4(), 0);
     localSocket.open(local.protocol());
     localSocket.bind(local);
+    localSocket.non_blocking(true); // 接收环非阻塞取包
+    predictor = make_unique<PlanePredictor>();
     // 保持udp连接
     addDataref("sim/network/misc/network_time_sec");
-    io_context.reset();
-    io_context.run();
+    if (engine == nullptr) {
+        io_context.reset();
+        io_context.run();
+    }
     // 启动接收
-    ioThread = thread([this] () { startReceive(); });
+    if (beaconSocket.is_open())
+        asio::post(strand_, [this] () { armDiscovery(); });
+    startReceive();
+    if (engine == nullptr)
+        ioThread = thread([this] () {
+            io_context.restart();
+            io_context.run();
+        });
 }
 
 XPlaneUdp::~XPlaneUdp () {
@@ -35,26 +184,99 @@ XPlaneUdp::~XPlaneUdp () {
 
 /**
  * @brief 关闭udp后接发无法使用 !
+ * 等待 io 线程处理完本实例的任务, 不得在 io 线程 (含各类回调) 中调用, 否则抛出 logic_error; 析构时同样检查
  */
 void XPlaneUdp::close () {
-    // 关闭线程
+    if (io_context.get_executor().running_in_this_thread()) // 共享线程池下本线程被占用, 本实例的任务可能无线程执行
+        throw logic_error("XPlaneUdp must not be closed from its io thread.");
+    // 关闭线程, 取消常驻的接收与看门狗后 io_context 自然退出
     runThread.store(false);
-    localSocket.cancel();
+    if (engine != nullptr)
+        engine->detach(this);
+    asio::post(strand_, [this] () {
+        localSocket.cancel();
+        watchdog.cancel();
+        if (beaconSocket.is_open())
+            beaconSocket.cancel();
+    });
+    if (engine != nullptr) // 共享线程池不停止, 等本实例的常驻操作全部结束
+        settle();
     if (ioThread.joinable())
         ioThread.join();
+    if (engine == nullptr)
+        io_context.restart();
+    // 停止共享内存发布, io 线程已退出
+    unique_lock<mutex> sharedLock{sharedMutex};
+    shared.reset();
+    sharedLock.unlock();
+    sharedIo.reset();
+    // 停止飞行记录
+    recording.store(false);
+    recorder.reset(); // 析构时写完剩余数据, 不报告写入错误, 需要时先调用 stopRecording
     // 停止udp接收
-    shared_lock<shared_mutex> lock{datarefMutex};
-    vector<string> allDatarefs;
-    for (auto &item : dataref.right)
-        allDatarefs.emplace_back(item.first);
+    unique_lock<mutex> locky{datarefIndexMutex};
+    unique_lock<shared_mutex> elementsLock{arrayElementsMutex};
+    unique_lock<shared_mutex> lock{datarefMutex};
+    const auto requests = subscriptions.clear(); // 不论引用计数全部退订
+    dataref.clear();
+    arrayElements.clear();
+    for (int32_t slot = 0; slot < DatarefCatalog::SLOTS; ++slot)
+        catalogIds[slot].store(0, memory_order_release);
+    for (size_t entry = 0; entry < DatarefCatalog::size(); ++entry)
+        catalogLengths[entry].store(0, memory_order_release);
     lock.unlock();
-    addBasicInfo(0);
-    addDataref("inop");
-    for (auto &item : allDatarefs)
-        addDataref(item, 0);
-    io_context.poll();
+    elementsLock.unlock();
+    locky.unlock();
+    unique_lock<mutex> groupsLock{dataGroupsMutex};
+    vector<int32_t> selected(dataGroups.begin(), dataGroups.end());
+    dataGroups.clear();
+    groupsLock.unlock();
+    // 退订在 io 线程入队, 超出发送队列容量的部分进入溢出列表, 无需等待队列腾出位置; 随即在本任务中发出
+    asio::post(strand_, [this, requests = move(requests), selected = move(selected)] () {
+        addBasicInfo(0);
+        selectDataGroups(DATA_UNSELECT_HEAD, selected);
+        sendRequests(requests);
+        drainSendQueue();
+    });
+    if (engine == nullptr) {
+        io_context.run(); // io 线程已退出, 由本线程清空发送队列
+        return;
+    }
+    settle(); // 退订由线程池发出
+}
+
+/**
+ * @brief 等待本实例已投递到 strand 的任务执行完毕且常驻异步操作全部结束, 共享线程池下关闭时使用
+ * 计数归零时由 finishOp 唤醒, 再向 strand 投递一个任务确认没有本实例的处理函数仍在执行或重新发起操作,
+ * 也没有已安排但尚未执行的发送
+ */
+void XPlaneUdp::settle () {
+    unique_lock<mutex> lock{settleMutex};
+    while (true) {
+        settleSignal.wait(lock, [this] () { return pendingOps.load() == 0; });
+        bool reached{false}, idle{false};
+        // 排在之前投递的任务之后; 在 strand 上读取计数, 为 0 时不会有本实例的处理函数仍在执行
+        asio::post(strand_, [this, &reached, &idle] () {
+            lock_guard<mutex> markLock{settleMutex};
+            reached = true;
+            idle = (pendingOps.load() == 0) && !sendScheduled.load(); // 已安排的 drainSendQueue 排在本任务之后
+            settleSignal.notify_all();
+        });
+        settleSignal.wait(lock, [&reached] () { return reached; });
+        if (idle)
+            return;
+    }
 }
 
+/**
+ * @brief 常驻异步操作结束, 计数归零时唤醒 settle
+ */
+void XPlaneUdp::finishOp () {
+    if (--pendingOps == 0) {
+        lock_guard<mutex> lock{settleMutex};
+        settleSignal.notify_all();
+    }
+}
 
 /**
  * @brief 获取是否 XPlaneTimeOut
@@ -64,45 +286,541 @@ bool XPlaneUdp::getState () {
 }
 
 /**
- * @brief 开始接收异步接收
+ * @brief 当前 xp 地址, 后台发现可能随时切换
  */
-void XPlaneUdp::startReceive () {
-    ip::udp::endpoint temp{};
-    UdpBuffer udpReceive{};
-    size_t length;
-    while (runThread) {
-        try {
-            length = receiveUdpData(udpReceive, localSocket, temp, 3000);
-        } catch (const XPlaneTimeout &e) {
-            cerr << e.what();
-            timeout.store(true);
+ip::udp::endpoint XPlaneUdp::endpoint () {
+    unique_lock<mutex> lock{endpointMutex};
+    return remoteEndpoint;
+}
+
+/**
+ * @brief 运行统计快照, 不打断 io 线程
+ * @return 统计编译关闭时全为 0
+ */
+MetricsSnapshot XPlaneUdp::metrics () {
+    MetricsSnapshot result;
+#if XPLANEUDP_METRICS
+    result.datagrams = stats.datagrams.load(memory_order_relaxed);
+    result.bytes = stats.bytes.load(memory_order_relaxed);
+    result.rrefPairs = stats.rrefPairs.load(memory_order_relaxed);
+    result.unknownPairs = stats.unknownPairs.load(memory_order_relaxed);
+    result.rposFrames = stats.rposFrames.load(memory_order_relaxed);
+    result.dataRecords = stats.dataRecords.load(memory_order_relaxed);
+    result.unknownRecords = stats.unknownRecords.load(memory_order_relaxed);
+    result.sends = stats.sends.load(memory_order_relaxed);
+    result.sendErrors = stats.sendErrors.load(memory_order_relaxed);
+    result.resubscribes = stats.resubscribes.load(memory_order_relaxed);
+    result.staleResubscribes = stats.staleResubscribes.load(memory_order_relaxed);
+    result.endpointChanges = stats.endpointChanges.load(memory_order_relaxed);
+    result.handlerTime = stats.handlerTime.snapshot();
+    result.interArrival = stats.interArrival.snapshot();
+    // 最新值年龄: 槽位中的包序号换算为接收时间
+    const int64_t now = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+    shared_lock<shared_mutex> elementsLock{arrayElementsMutex};
+    shared_lock<shared_mutex> lock{datarefMutex};
+    for (const auto &item : dataref.left) {
+        if (arrayElements.count(item.second) != 0) // 数组本身不接收数据
             continue;
+        const DatarefTable::Slot* slot = latestDataref.slot(item.first);
+        const uint32_t serial = (slot == nullptr) ? 0 : DatarefTable::decodeSerial(slot->load(memory_order_acquire));
+        if (serial == 0)
+            ++result.neverReceived;
+        else if (const auto time = packetClock.time(serial); time.has_value())
+            result.valueAge.record(max<int64_t>(0, now - *time));
+        else
+            ++result.agedOut;
+    }
+    result.idLimit = ids.end();
+    result.idsFree = ids.available();
+    result.idsQuarantined = ids.quarantined();
+#endif
+    return result;
+}
+
+/**
+ * @brief 在 strand 上启动常驻接收链与看门狗, 持续到 close
+ */
+void XPlaneUdp::startReceive () {
+    asio::post(strand_, [this] () {
+        lastReceive = chrono::steady_clock::now();
+        armReceive();
+        armWatchdog(lastReceive + DatarefHealth::PERIOD);
+    });
+}
+
+/**
+ * @brief 等待 socket 可读, 一次取空后继续等待
+ */
+void XPlaneUdp::armReceive () {
+    ++pendingOps;
+    localSocket.async_wait(ip::udp::socket::wait_read, asio::bind_executor(strand_, [this](const sys::error_code &error) {
+        finishOp();
+        if ((error == asio::error::operation_aborted) || !runThread)
+            return;
+        bool received{false};
+        for (size_t count; (count = receiveRing.receive(localSocket)) > 0;) {
+            auto now = chrono::steady_clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                const string_view packet = receiveRing.packet(i);
+                receiveTime = chrono::duration_cast<chrono::nanoseconds>(now.time_since_epoch()).count();
+#if XPLANEUDP_METRICS
+                Metrics::add(stats.datagrams);
+                Metrics::add(stats.bytes, packet.size());
+#endif
+                if (packet.size() < 5)
+                    continue;
+                received = true;
+                if (capture)
+                    capture->write(now, CaptureDirection::RECEIVE, packet);
+                handleReceive(packet);
+                for (const auto &history : histories)
+                    history->record(now);
+                const auto done = chrono::steady_clock::now(); // 同时作为下一个数据报的接收时间, 每包只读一次时钟
+#if XPLANEUDP_METRICS
+                stats.handlerTime.record(chrono::duration_cast<chrono::nanoseconds>(done - now).count());
+#endif
+                now = done;
+            }
+            if (received) {
+                lastReceive = now;
+                connected = true;
+            }
+            if (count < receiveRing.capacity())
+                break;
+        }
+        if (received) {
+            timeout.store(false, memory_order_relaxed);
+            for (const auto &group : groups) // 每批数据发布一次, 同帧拆分的多个包一起生效
+                group->publish();
+            for (const auto &watch : watches) // 在组发布之后, 组回调读到的是本批快照
+                watch->check();
+            notifyUpdate();
+            if (sharedIo)
+                sharedIo->beat();
+        }
+        armReceive();
+    }));
+}
+
+/**
+ * @brief 看门狗: 每个检查周期检查订阅健康, 到期时检查最近接收时间, 收包路径上不触碰定时器
+ * @param deadline 下次检查时间
+ */
+void XPlaneUdp::armWatchdog (const chrono::steady_clock::time_point deadline) {
+    watchdog.expires_at(deadline);
+    ++pendingOps;
+    watchdog.async_wait(asio::bind_executor(strand_, [this](const sys::error_code &error) {
+        finishOp();
+        if ((error == asio::error::operation_aborted) || !runThread)
+            return;
+        const auto now = chrono::steady_clock::now();
+        if (now - lastReceive < RECEIVE_TIMEOUT) {
+            checkHealth(now);
+            armWatchdog(min(lastReceive + RECEIVE_TIMEOUT, now + DatarefHealth::PERIOD));
+            return;
+        }
+        if (!timeout.exchange(true)) // 超时期间每个周期检查一次
+            cerr << XPlaneTimeout().what() << endl;
+        resubscribe(); // XPlane 重启后不记得订阅, 每个周期整体重发一次直到恢复
+        armWatchdog(now + RECEIVE_TIMEOUT);
+    }));
+}
+
+/**
+ * @brief 订阅健康检查, 其余订阅照常更新时只对停更的订阅重新订阅, 仅 io 线程调用
+ * 订阅变更持有 datarefIndexMutex 时本周期跳过, 避免与变更线程等待发送队列互等, 也不会发出已退订的请求
+ * @param now 当前时间
+ */
+void XPlaneUdp::checkHealth (const chrono::steady_clock::time_point now) {
+    unique_lock<mutex> locky{datarefIndexMutex, try_to_lock};
+    if (!locky.owns_lock())
+        return;
+    shared_lock<shared_mutex> lock{datarefMutex};
+    const auto subscribed = subscriptions.requests();
+    lock.unlock();
+    const auto requests = health.check(subscribed, latestDataref, packetClock, now);
+    auto status = health.status(now);
+    unique_lock<mutex> statusLock{healthMutex};
+    healthStatus.swap(status);
+    statusLock.unlock();
+    if (requests.empty())
+        return;
+    sendRequests(requests);
+#if XPLANEUDP_METRICS
+    Metrics::add(stats.staleResubscribes, requests.size());
+#endif
+}
+
+/**
+ * @brief 将 dataref 组交给 io 线程发布
+ */
+void XPlaneUdp::registerGroup (shared_ptr<GroupCore> core) {
+    asio::post(strand_, [this, core = move(core)] () mutable { groups.push_back(move(core)); });
+}
+
+/**
+ * @brief 从 io 线程移除 dataref 组, 再逐个退订组持有的成员订阅
+ */
+void XPlaneUdp::unregisterGroup (shared_ptr<GroupCore> core) {
+    if (!core->release())
+        return;
+    asio::post(strand_, [this, core] () {
+        groups.erase(remove(groups.begin(), groups.end(), core), groups.end());
+    });
+    for (const auto &field : core->layout())
+        removeDataref(field.dataRef, core->frequency(), field.index);
+}
+
+/**
+ * @brief 为订阅开启历史记录, 由 io 线程在每个数据包后追加样本
+ * @param handle 订阅句柄
+ * @param capacity 样本容量, 向上取整到 2 的幂
+ * @return 历史句柄, 句柄无效时为空
+ */
+DatarefHistory XPlaneUdp::enableHistory (const DatarefHandle<> &handle, const size_t capacity) {
+    if (!handle)
+        return {};
+    auto ring = make_shared<HistoryRing>(handle, capacity);
+    asio::post(strand_, [this, ring] () { histories.push_back(ring); });
+    return DatarefHistory{move(ring)};
+}
+
+/**
+ * @brief 停止历史记录, 已有样本仍可读
+ * @param history 历史句柄
+ */
+void XPlaneUdp::disableHistory (const DatarefHistory &history) {
+    if (!history)
+        return;
+    asio::post(strand_, [this, ring = history.handle()] () {
+        histories.erase(remove(histories.begin(), histories.end(), ring), histories.end());
+    });
+}
+
+/**
+ * @brief dataref 更新时回调, 由 io 线程在每批数据处理完后检查, 同一批内多次更新只通知最新值
+ * @param handle 订阅句柄
+ * @param callback 回调, 参数为新值与包序号; 在 io 线程执行时应尽快返回
+ * @param deadband 过滤阈值, 小于 0 每次更新都通知, 0 时值变化才通知, 大于 0 时与上次通知的值相差超过阈值才通知
+ * @param executor 执行回调的执行器, 为空时直接在 io 线程执行
+ * @return 通知句柄, 句柄无效时为空
+ */
+DatarefWatch XPlaneUdp::onUpdate (const DatarefHandle<> &handle, UpdateCallback callback, const float deadband,
+                                  const asio::any_io_executor &executor) {
+    if (!handle || !callback)
+        return {};
+    return registerWatch({handle}, deadband,
+                         [slot = handle.slot(), callback = move(callback), executor] (const uint32_t serial) {
+                             const float value = DatarefTable::decodeValue(slot->load(memory_order_relaxed));
+                             if (executor)
+                                 asio::post(executor, [callback, value, serial] () { callback(value, serial); });
+                             else
+                                 callback(value, serial);
+                         });
+}
+
+/**
+ * @brief 取消更新通知, 已投递到执行器的回调仍会执行
+ * @param watch 通知句柄
+ */
+void XPlaneUdp::removeWatch (const DatarefWatch &watch) {
+    if (!watch)
+        return;
+    asio::post(strand_, [this, core = watch.handle()] () {
+        watches.erase(remove(watches.begin(), watches.end(), core), watches.end());
+    });
+}
+
+/**
+ * @brief 阻塞等待 dataref 更新, 替代轮询
+ * @param handle 订阅句柄
+ * @param deadline 截止时间
+ * @param deadband 过滤阈值, 与调用时的值比较, 规则同 onUpdate
+ * @return 新值, 超时或订阅被移除时为空
+ */
+optional<float> XPlaneUdp::waitForUpdate (const DatarefHandle<> &handle, const chrono::steady_clock::time_point deadline,
+                                          const float deadband) {
+    if (!handle)
+        return nullopt;
+    const uint64_t base = handle.slot()->load(memory_order_acquire);
+    uint32_t seen = DatarefTable::decodeSerial(base);
+    optional<float> result;
+    waitUntil([&] () {
+        const uint64_t word = handle.slot()->load(memory_order_acquire);
+        if (!handle.current()) // id 已释放, 之后的写入不属于本订阅
+            return true;
+        const uint32_t serial = DatarefTable::decodeSerial(word);
+        if (serial == seen)
+            return false;
+        seen = serial;
+        const float value = DatarefTable::decodeValue(word);
+        if ((DatarefTable::decodeSerial(base) != 0) && !WatchCore::passes(DatarefTable::decodeValue(base), value, deadband))
+            return false;
+        result = value;
+        return true;
+    }, deadline);
+    return result;
+}
+
+/**
+ * @brief 将更新通知交给 io 线程检查
+ */
+DatarefWatch XPlaneUdp::registerWatch (vector<DatarefHandle<>> members, const float deadband, WatchCore::Fire fire) {
+    auto core = make_shared<WatchCore>(move(members), deadband, move(fire));
+    asio::post(strand_, [this, core] () { watches.push_back(core); });
+    return DatarefWatch{move(core)};
+}
+
+/**
+ * @brief 在截止时间前等待条件成立, 每批数据处理完后重新检查
+ * @param ready 条件, 持有 updateMutex 时调用
+ * @param deadline 截止时间
+ * @return 条件是否成立
+ */
+bool XPlaneUdp::waitUntil (const function<bool ()> &ready, const chrono::steady_clock::time_point deadline) {
+    waiters.fetch_add(1); // 先登记再检查, 与 notifyUpdate 中先写值再读等待数配对
+    unique_lock<mutex> lock{updateMutex};
+    const bool done = updateSignal.wait_until(lock, deadline, ready);
+    lock.unlock();
+    waiters.fetch_sub(1);
+    return done;
+}
+
+/**
+ * @brief 有等待者时唤醒, 无人等待的收包路径上只多一次内存屏障
+ */
+void XPlaneUdp::notifyUpdate () {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (waiters.load(memory_order_relaxed) == 0)
+        return;
+    { lock_guard<mutex> lock{updateMutex}; } // 等待者检查条件与进入等待之间不会错过唤醒
+    updateSignal.notify_all();
+}
+
+/**
+ * @brief 开始抓包, 记录此后所有收发的数据报; 已有订阅先以 RREF 记录写入, 供回放时按名称映射 id
+ * @param path 抓包文件路径, 已存在则覆盖
+ */
+void XPlaneUdp::startCapture (const string &path) {
+    auto writer = make_unique<CaptureWriter>(path);
+    const auto now = chrono::steady_clock::now();
+    shared_lock<shared_mutex> lock{datarefMutex};
+    for (const auto &item : dataref.left) {
+        array<char, HEADER_LENGTH + 2 * sizeof(int32_t) + RREF_NAME_SIZE> buffer{};
+        pack(buffer, 0, DATAREF_GET_HEAD, int32_t{1}, item.first, item.second);
+        writer->write(now, CaptureDirection::SEND, {buffer.data(), buffer.size()});
+    }
+    lock.unlock();
+    asio::post(strand_, [this, writer = move(writer)] () mutable { capture = move(writer); });
+}
+
+/**
+ * @brief 停止抓包并写出文件
+ */
+void XPlaneUdp::stopCapture () {
+    asio::post(strand_, [this] () {
+        if (capture)
+            capture->flush();
+        capture.reset();
+    });
+}
+
+/**
+ * @brief 开始飞行记录, 此后收到的每个 RREF 数据对与 RPOS 帧按列压缩写入文件, 已在记录时先停止旧记录
+ * @param path 记录文件路径, 已存在则覆盖
+ */
+void XPlaneUdp::startRecording (const string &path) {
+    stopRecording();
+    auto writer = make_unique<RecordWriter>(path);
+    shared_lock<shared_mutex> elementsLock{arrayElementsMutex};
+    shared_lock<shared_mutex> lock{datarefMutex}; // 与订阅互斥, 已有订阅在此命名, 此后的变化由 publishName 转交
+    for (const auto &item : dataref.left)
+        if (arrayElements.count(item.second) == 0)
+            writer->name(item.first, item.second, 0);
+    recording.store(true);
+    asio::post(strand_, [this, writer = move(writer)] () mutable { recorder = move(writer); });
+}
+
+/**
+ * @brief 停止飞行记录, 等待剩余数据写入文件后返回; 在 io 线程上调用时由 io 线程写入
+ * @return 写入的样本数, 未在记录时为 0; 记录期间写入文件出错时抛出 runtime_error
+ */
+uint64_t XPlaneUdp::stopRecording () {
+    recording.store(false);
+    unique_ptr<RecordWriter> writer;
+    if (runThread.load() && !strand_.running_in_this_thread()) {
+        promise<unique_ptr<RecordWriter>> taken;
+        asio::post(strand_, [this, &taken] () { taken.set_value(move(recorder)); });
+        writer = taken.get_future().get();
+    } else {
+        writer = move(recorder);
+    }
+    return writer ? writer->close() : 0;
+}
+
+/**
+ * @brief 开始把最新 dataref 值与 RPOS 发布到共享内存, 本机其他进程用 SharedReader 读取, 无需各自订阅
+ * @param name 共享内存名称, 同名旧段会被替换
+ * @param slots 槽位数, 不小于它的 id 不发布
+ * @param names 名称目录容量, 按 id 存放, 发布期间不小于它的 id 无法分配, 订阅超出时抛出 length_error;
+ * 已有订阅的 id 超出时抛出 length_error, 不开始发布
+ */
+void XPlaneUdp::startSharedMemory (const string &name, const uint32_t slots, const uint32_t names) {
+    auto publisher = make_shared<SharedPublisher>(name, slots, names);
+    shared_lock<shared_mutex> elementsLock{arrayElementsMutex};
+    shared_lock<shared_mutex> lock{datarefMutex}; // 与订阅互斥, 已有订阅与此后的订阅恰好各发布一次
+    for (const auto &item : dataref.left) {
+        const auto it = arrayElements.find(item.second);
+        if (!publisher->publishName(item.first, item.second,
+                                    (it == arrayElements.end()) ? 0 : static_cast<int32_t>(it->second.size())))
+            throw length_error("Shared memory name directory too small: " + item.second);
+    }
+    unique_lock<mutex> sharedLock{sharedMutex};
+    shared = publisher;
+    sharedLock.unlock();
+    lock.unlock();
+    elementsLock.unlock();
+    asio::post(strand_, [this, publisher = move(publisher)] () mutable { sharedIo = move(publisher); });
+}
+
+/**
+ * @brief 停止发布并删除共享内存, 已映射的读者仍可读到最后的值
+ */
+void XPlaneUdp::stopSharedMemory () {
+    unique_lock<mutex> lock{sharedMutex};
+    shared.reset();
+    lock.unlock();
+    asio::post(strand_, [this] () { sharedIo.reset(); });
+}
+
+/**
+ * @brief 向共享内存发布新订阅的名称, 记录中时把名称变化交给 io 线程, 调用方持有 datarefMutex
+ * id 已由 allocateIds 限制在目录容量内, 名称过长无法发布时只提示, 不影响订阅
+ */
+void XPlaneUdp::publishName (const int32_t id, const string &name, const int32_t length) {
+    if (recording.load()) // 先于随后发出的订阅请求入队, 新 id 的数据到达前已命名
+        asio::post(strand_, [this, id, name, length] () {
+            if (recorder)
+                recorder->name(id, name, length);
+        });
+    unique_lock<mutex> lock{sharedMutex};
+    if (shared && !shared->publishName(id, name, length))
+        cerr << "Dataref not published to shared memory: " << name << endl;
+}
+
+/**
+ * @brief 从共享内存清除退订的名称, 记录中时把名称变化交给 io 线程, 调用方持有 datarefMutex
+ */
+void XPlaneUdp::unpublishName (const int32_t id, const string &name) {
+    if (recording.load())
+        asio::post(strand_, [this, name] () {
+            if (recorder)
+                recorder->name(-1, name, 0);
+        });
+    unique_lock<mutex> lock{sharedMutex};
+    if (shared)
+        shared->removeName(id);
+}
+
+/**
+ * @brief 批量发出发送队列中的包, 溢出列表中的包随队列腾出位置依次补入, 仅 io 线程调用
+ * 已在等待 socket 可写时直接返回, 由等待完成后继续, 同一时刻只有一个等待
+ */
+void XPlaneUdp::drainSendQueue () {
+    sendScheduled.store(false);
+    if (writeWaiting)
+        return;
+    array<SendQueue::Packet*, SEND_BATCH> batch{};
+    while (true) {
+        for (; !sendOverflow.empty(); sendOverflow.pop_front()) { // 推入失败时保留回调
+            const auto &packet = sendOverflow.front();
+            if (!sendQueue.push(packet.data.data(), packet.size, packet.handler))
+                break;
         }
-        if (length < 5)
+        const size_t count = sendQueue.peek(batch.data(), batch.size());
+        if (count == 0)
+            return;
+        const size_t done = sendBatch(batch.data(), count);
+        sendQueue.release(done);
+        if (done < count) { // 发送缓冲区满, 可写后继续
+            writeWaiting = true;
+            ++pendingOps;
+            localSocket.async_wait(ip::udp::socket::wait_write, asio::bind_executor(strand_, [this](const sys::error_code &) {
+                finishOp();
+                writeWaiting = false;
+                drainSendQueue();
+            }));
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 发送一批包并执行各自的回调
+ * @param packets 待发送包
+ * @param count 数量
+ * @return 已处理的包数量, 小于 count 表示发送缓冲区已满
+ */
+size_t XPlaneUdp::sendBatch (SendQueue::Packet** packets, const size_t count) {
+    const auto now = chrono::steady_clock::now();
+    const auto notify = [this, now](SendQueue::Packet* packet, const sys::error_code &error) {
+        if (capture && !error)
+            capture->write(now, CaptureDirection::SEND, {packet->data.data(), packet->size});
+#if XPLANEUDP_METRICS
+        Metrics::add(error ? stats.sendErrors : stats.sends);
+#endif
+        if (packet->handler)
+            packet->handler(error);
+    };
+    size_t done{0};
+    if (!hasEndpoint) { // 尚未发现 xp, 订阅在发现后整体重发
+        for (; done < count; ++done)
+            notify(packets[done], asio::error::not_connected);
+        return done;
+    }
+#ifdef __linux__
+    array<mmsghdr, SEND_BATCH> headers{};
+    array<iovec, SEND_BATCH> iovecs{};
+    for (size_t i = 0; i < count; ++i) {
+        iovecs[i] = {packets[i]->data.data(), packets[i]->size};
+        headers[i].msg_hdr.msg_name = remoteEndpoint.data();
+        headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(remoteEndpoint.size());
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (done < count) {
+        const int sent = sendmmsg(localSocket.native_handle(), headers.data() + done,
+                                  static_cast<unsigned int>(count - done), 0);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+            notify(packets[done++], sys::error_code(errno, sys::system_category())); // 跳过出错的包
             continue;
-        timeout.store(false);
-        handleReceive({udpReceive.begin(), udpReceive.begin() + length});
+        }
+        for (int i = 0; i < sent; ++i)
+            notify(packets[done++], {});
     }
+#else
+    for (; done < count; ++done) {
+        sys::error_code error;
+        localSocket.send_to(asio::buffer(packets[done]->data.data(), packets[done]->size), remoteEndpoint, 0, error);
+        if (error == asio::error::would_block)
+            break;
+        notify(packets[done], error);
+    }
+#endif
+    return done;
 }
 
 /**
  * @brief 寻找电脑上运行的 XPlane 实例
  */
 void XPlaneUdp::autoUdpFind () {
-    // 创建 UDP 并允许端口复用
     ip::udp::socket multicastSocket(io_context);
-    multicastSocket.open(ip::udp::v4());
-    asio::socket_base::reuse_address option(true);
-    multicastSocket.set_option(option);
-    // 绑定至多播
-    ip::udp::endpoint multicastEndpoint;
-    if (IS_WIN)
-        multicastEndpoint = ip::udp::endpoint(ip::udp::v4(), MULTI_CAST_PORT);
-    else
-        multicastEndpoint = ip::udp::endpoint(ip::make_address(MULTI_CAST_GROUP), MULTI_CAST_PORT);
-    multicastSocket.bind(multicastEndpoint);
-    ip::address_v4 multicast_address = ip::make_address_v4(MULTI_CAST_GROUP);
-    multicastSocket.set_option(ip::multicast::join_group(multicast_address));
+    joinMulticast(multicastSocket);
     // 接收数据
     UdpBuffer buffer{};
     ip::udp::endpoint senderEndpoint;
@@ -117,72 +835,289 @@ void XPlaneUdp::autoUdpFind () {
         cout << hex << setw(2) << setfill('0') << (static_cast<unsigned int>(buffer[i]) & 0xff);
     cout << endl;
     // 解析数据
-    if ((bytesReceived < 5 + 16) || (string_view{buffer.data(), 5} != BECON_HEAD)) { // 非xp数据
+    const auto beacon = parseBeacon({buffer.data(), bytesReceived});
+    if (!beacon.has_value()) { // 非xp数据
         cerr << "Unknown packet from " << senderEndpoint << endl;
         cout << buffer.size() << " bytes" << endl;
         for (const auto &byte : buffer)
             cout << hex << setw(2) << setfill('0') << (static_cast<unsigned int>(byte) & 0xff);
         cout << endl;
-    } else { // xp数据
-        string_view data{buffer.data() + 5, 16};
-        uint8_t mainVer, minorVer;
-        int32_t software, xpVer;
-        uint32_t role;
-        uint16_t port;
-        unpack(data, 0, mainVer, minorVer, software, xpVer, role, port);
-        if ((mainVer == 1) && (minorVer <= 2) && (software == 1)) {
-            cout << "XPlane Beacon Version: " << static_cast<int>(mainVer) << '.' << static_cast<int>(minorVer) << '.'
-                    << software << endl;
-            cout << dec << "IP: " << senderEndpoint.address() << ", Port: " << port << ", hostname: " << string_view{
-                buffer.data() + 21, bytesReceived - 24
-            } << ", XPlaneVersion: " << xpVer << ", role: " << role << endl;
-            this->remoteEndpoint = ip::udp::endpoint(ip::make_address(senderEndpoint.address().to_string()), port);
-        } else {
-            cerr << "XPlane Beacon Version not supported: " << mainVer << '.' << minorVer << '.' << software << endl;
-            throw XPlaneVersionNotSupported();
-        }
+    } else if ((beacon->mainVer == 1) && (beacon->minorVer <= 2) && (beacon->software == 1)) { // xp数据
+        cout << "XPlane Beacon Version: " << static_cast<int>(beacon->mainVer) << '.'
+                << static_cast<int>(beacon->minorVer) << '.' << beacon->software << endl;
+        cout << dec << "IP: " << senderEndpoint.address() << ", Port: " << beacon->port << ", hostname: "
+                << beacon->hostname << ", XPlaneVersion: " << beacon->xpVer << ", role: " << beacon->role << endl;
+        this->remoteEndpoint = ip::udp::endpoint(senderEndpoint.address(), beacon->port);
+    } else {
+        cerr << "XPlane Beacon Version not supported: " << beacon->mainVer << '.' << beacon->minorVer << '.'
+                << beacon->software << endl;
+        throw XPlaneVersionNotSupported();
     }
 }
 
+/**
+ * @brief 解析 BECN 数据报
+ * @param packet 完整数据报
+ * @return 非 BECN 时为空, 不检查版本
+ */
+optional<XPlaneBeacon> XPlaneUdp::parseBeacon (const string_view packet) {
+    if ((packet.size() < HEADER_LENGTH + 16) || (packet.substr(0, HEADER_LENGTH) != BECON_HEAD))
+        return nullopt;
+    XPlaneBeacon beacon;
+    unpack(packet, HEADER_LENGTH, beacon.mainVer, beacon.minorVer, beacon.software, beacon.xpVer, beacon.role,
+           beacon.port);
+    const string_view name = packet.substr(HEADER_LENGTH + 16);
+    beacon.hostname = string{name.substr(0, name.find('\x00'))};
+    return beacon;
+}
+
+/**
+ * @brief 打开 socket 并加入 BECN 多播组, 允许端口复用
+ */
+void XPlaneUdp::joinMulticast (ip::udp::socket &socket) {
+    socket.open(ip::udp::v4());
+    socket.set_option(asio::socket_base::reuse_address(true));
+    ip::udp::endpoint multicastEndpoint;
+    if (IS_WIN)
+        multicastEndpoint = ip::udp::endpoint(ip::udp::v4(), MULTI_CAST_PORT);
+    else
+        multicastEndpoint = ip::udp::endpoint(ip::make_address(MULTI_CAST_GROUP), MULTI_CAST_PORT);
+    socket.bind(multicastEndpoint);
+    socket.set_option(ip::multicast::join_group(ip::make_address_v4(MULTI_CAST_GROUP)));
+}
+
+/**
+ * @brief 后台监听 BECN: 尚无地址, 当前地址从未收到数据或已超时时, 切换到发出 BECN 的 xp
+ * 当前地址正常收数时忽略其他 xp, 不在多个实例之间来回切换
+ */
+void XPlaneUdp::armDiscovery () {
+    ++pendingOps;
+    beaconSocket.async_receive_from(asio::buffer(beaconBuffer), beaconSender, asio::bind_executor(
+                                        strand_, [this](const sys::error_code &error, const size_t bytes) {
+        finishOp();
+        if ((error == asio::error::operation_aborted) || !runThread)
+            return;
+        const auto beacon = error ? nullopt : parseBeacon({beaconBuffer.data(), bytes});
+        if (beacon.has_value() && (beacon->mainVer == 1) && (beacon->minorVer <= 2) && (beacon->software == 1))
+            handleBeacon({beaconSender.address(), beacon->port});
+        armDiscovery();
+    }));
+}
+
+/**
+ * @brief 处理一个 xp 的 BECN, 仅 io 线程调用
+ * 共享线程池下只会收到本地址的 BECN, 不切换地址
+ * @param found 发出 BECN 的 xp 地址
+ */
+void XPlaneUdp::handleBeacon (const ip::udp::endpoint &found) {
+    if (!runThread)
+        return;
+    if ((found != remoteEndpoint) && (engine == nullptr) && (!hasEndpoint || !connected || timeout.load()))
+        switchEndpoint(found);
+    else if ((found == remoteEndpoint) && timeout.load())
+        resubscribe(); // xp 原地重启, 不必等看门狗
+}
+
+/**
+ * @brief 切换 xp 地址并整体重新订阅, 仅 io 线程调用
+ * @param found 新地址
+ */
+void XPlaneUdp::switchEndpoint (const ip::udp::endpoint &found) {
+    unique_lock<mutex> lock{endpointMutex};
+    remoteEndpoint = found;
+    lock.unlock();
+    hasEndpoint = true;
+    connected = false;
+    if (!endpointCache.empty())
+        saveEndpoint(endpointCache, found);
+#if XPLANEUDP_METRICS
+    Metrics::add(stats.endpointChanges);
+#endif
+    resubscribe();
+}
+
 /**
  * @brief 处理接收到的udp数据
  * @param received 接收数据
  */
-void XPlaneUdp::handleReceive (vector<char> received) {
+void XPlaneUdp::handleReceive (const string_view received) {
     if (equal(DATAREF_GET_HEAD.begin(), DATAREF_GET_HEAD.begin() + 4, received.begin())) { // dataref,文档有误实际返回 RREF,
-        unique_lock<mutex> lock{latestDatarefMutex};
-        for (int i = HEADER_LENGTH; i < received.size(); i += 8) {
-            int index;
-            float value;
-            unpack(received, i, index, value);
-            latestDataref[index] = value;
-        }
+        if (++packetSerial == 0) // 0 保留给未收到
+            packetSerial = 1;
+        const string_view pairs = received.substr(HEADER_LENGTH);
+        const int32_t allocated = datarefIndex.load(memory_order_relaxed);
+        packetClock.record(packetSerial, receiveTime);
+        health.grow(allocated);
+#if XPLANEUDP_METRICS
+        Metrics::add(stats.rrefPairs, pairs.size() / 8);
+        const auto interArrival = [this](const int32_t id, const DatarefTable::Slot &slot) { // 槽位中的旧包序号即上次更新
+            health.count(id);
+            if (const auto last = packetClock.ownTime(DatarefTable::decodeSerial(slot.load(memory_order_relaxed))))
+                stats.interArrival.record(receiveTime - *last);
+        };
+        Metrics::add(stats.unknownPairs, decodeRref(pairs, latestDataref, allocated, packetSerial, interArrival));
+#else
+        decodeRref(pairs, latestDataref, allocated, packetSerial,
+                   [this](const int32_t id, const DatarefTable::Slot &) { health.count(id); });
+#endif
+        if (sharedIo)
+            sharedIo->publishPairs(pairs, allocated, packetSerial);
+        if (recorder)
+            recorder->recordPairs(pairs, receiveTime);
+    } else if (equal(DATA_HEAD.begin(), DATA_HEAD.begin() + 4, received.begin())) { // DATA 输出, 第 5 字节不固定
+        if (++packetSerial == 0)
+            packetSerial = 1;
+        const string_view records = received.substr(HEADER_LENGTH);
+        packetClock.record(packetSerial, receiveTime); // 与 RREF 共用包序号, 时间环需连续
+#if XPLANEUDP_METRICS
+        Metrics::add(stats.dataRecords, records.size() / DataTable::RECORD_SIZE);
+        Metrics::add(stats.unknownRecords, latestData.decode(records, packetSerial));
+#else
+        latestData.decode(records, packetSerial);
+#endif
     } else if (equal(BASIC_INFO_HEAD.begin(), BASIC_INFO_HEAD.begin() + 4, received.begin())) { // 基本信息
-        receivedInfo.store(true);
+        if (received.size() < HEADER_LENGTH + sizeof(PlaneInfo))
+            return;
+#if XPLANEUDP_METRICS
+        Metrics::add(stats.rposFrames);
+#endif
+        PlaneInfo info;
+        unpack(received, HEADER_LENGTH, info);
+        if (sharedIo)
+            sharedIo->publishInfo(info);
+        if (recorder)
+            recorder->recordInfo(info, receiveTime);
+        const auto now = chrono::steady_clock::now(); // 每帧读一次时钟, RPOS 频率不高
         unique_lock<mutex> lock{latestBasicInfoMutex};
-        unpack(received, HEADER_LENGTH, latestBasicInfo);
+        latestBasicInfo = info;
+        predictor->record(info, now);
+        receivedInfo.store(true);
     }
 }
 
 /**
- * @brief 新增监听目标
+ * @brief 新增监听目标, 同名订阅共用一个 id, 向 XPlane 请求各使用者中的最高频率
  * @param dataRef dataref 名称
- * @param freq 频率, 0时停止
+ * @param freq 频率, 0 时移除一个使用者, 见 removeDataref
  * @param index 目标为数组时的索引
+ * @return 订阅句柄, 移除时为空句柄; 名称放不进 RREF 请求时抛出 length_error
  */
-void XPlaneUdp::addDataref (const string &dataRef, const int32_t freq, const int index) {
-    string combineName{(index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef};
+DatarefHandle<> XPlaneUdp::addDataref (const string &dataRef, const int32_t freq, const int index) {
+    const string combineName{(index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef};
     unique_lock<mutex> locky(datarefIndexMutex);
-    if (unique_lock<shared_mutex> lock{datarefMutex}; freq == 0) {
-        dataref.right.erase(combineName);
-        if (dataref.size() == 1) // 始终保留一个dataref维持udp通信
-            return;
-    } else
-        dataref.insert({datarefIndex, combineName});
-    array<char, 413> buffer{};
-    pack(buffer, 0, DATAREF_GET_HEAD, freq, datarefIndex, combineName);
-    sendUdpData(buffer);
-    ++datarefIndex;
+    if (freq == 0) {
+        releaseDataref(combineName, 0);
+        return {};
+    }
+    checkRrefName(combineName.size());
+    unique_lock<shared_mutex> lock{datarefMutex};
+    const int32_t id = subscriptions.find(combineName).value_or(-1);
+    const auto change = subscriptions.acquire(combineName, (id < 0) ? allocateIds(1) : id, freq);
+    if (change.created) {
+        dataref.insert({change.id, combineName});
+        indexCatalog(combineName, change.id);
+        publishName(change.id, combineName);
+    }
+    const DatarefHandle<> handle{change.id, latestDataref.slot(change.id), latestDataref.generation(change.id)};
+    lock.unlock();
+    if (change.request.has_value())
+        sendRequests({change.request.value()});
+    return handle;
+}
+
+/**
+ * @brief 移除一个监听使用者, 最后一个使用者离开时退订, 最快的使用者离开时降低请求频率
+ * @param dataRef dataref 名称
+ * @param freq 该使用者订阅时的频率, 0 时移除频率最低的使用者
+ * @param index 目标为数组时的索引
+ */
+void XPlaneUdp::removeDataref (const string &dataRef, const int32_t freq, const int index) {
+    const string combineName{(index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef};
+    unique_lock<mutex> locky(datarefIndexMutex);
+    releaseDataref(combineName, freq);
+}
+
+/**
+ * @brief 移除一个使用者并发出频率变化, 调用方持有 datarefIndexMutex
+ * @param name 完整名称
+ * @param freq 该使用者订阅时的频率
+ */
+void XPlaneUdp::releaseDataref (const string &name, const int32_t freq) {
+    unique_lock<shared_mutex> lock{datarefMutex};
+    const auto change = subscriptions.release(name, freq);
+    if (change.erased) {
+        dataref.right.erase(name);
+        indexCatalog(name, -1);
+        unpublishName(change.id, name);
+        latestDataref.retire(change.id); // 已有句柄随之失效
+        ids.release(change.id, 1);
+    }
+    lock.unlock();
+    if (change.request.has_value())
+        sendRequests({change.request.value()});
+}
+
+/**
+ * @brief 分配连续的 id, 调用方持有 datarefMutex
+ * 槽位由 io 线程清空, 与解码写入同在 strand 上; 清空排在之后发出的订阅请求之前, 在此之前句柄读不出上一个订阅的值
+ * @param count 数量
+ * @return 首个 id, 超出值表或共享内存目录容量时抛出 length_error
+ */
+int32_t XPlaneUdp::allocateIds (const int32_t count) {
+    const int32_t first = ids.allocate(count);
+    if (first < 0)
+        throw length_error("Dataref id out of table capacity.");
+    unique_lock<mutex> sharedLock{sharedMutex};
+    if (shared && (static_cast<uint32_t>(first + count) > shared->capacity())) { // 共享内存目录按 id 存放
+        sharedLock.unlock();
+        ids.discard(first, count);
+        throw length_error("Dataref id out of shared memory directory capacity.");
+    }
+    sharedLock.unlock();
+    for (int32_t id = first; id < first + count; ++id) {
+        latestDataref.reserve(id);
+        latestDataref.claim(id);
+    }
+    datarefIndex.store(ids.end(), memory_order_release);
+    asio::post(strand_, [this, first, count] () {
+        for (int32_t id = first; id < first + count; ++id) {
+            latestDataref.clear(id);
+            if (sharedIo)
+                sharedIo->clear(id);
+        }
+    });
+    return first;
+}
+
+/**
+ * @brief 发出 RREF 订阅请求, 不得持有 datarefMutex 调用, 以免与 io 线程的重新订阅互等
+ */
+void XPlaneUdp::sendRequests (const vector<SubscriptionTable::Request> &requests) {
+    array<char, HEADER_LENGTH + 2 * sizeof(int32_t) + RREF_NAME_SIZE> buffer{};
+    for (const auto &request : requests) {
+        buffer.fill('\x00');
+        pack(buffer, 0, DATAREF_GET_HEAD, request.freq, request.id, request.name);
+        sendUdpData(buffer);
+    }
+}
+
+/**
+ * @brief 超时后整体重新订阅: 全部 RREF, RPOS 与 DATA 组一次入队, 由 io 线程批量发出, 仅 io 线程调用
+ */
+void XPlaneUdp::resubscribe () {
+    shared_lock<shared_mutex> lock{datarefMutex};
+    const auto requests = subscriptions.requests();
+    lock.unlock();
+    sendRequests(requests);
+    if (const int32_t freq = basicInfoFreq.load(); freq > 0)
+        addBasicInfo(freq);
+    unique_lock<mutex> groupsLock{dataGroupsMutex};
+    const vector<int32_t> selected(dataGroups.begin(), dataGroups.end());
+    groupsLock.unlock();
+    selectDataGroups(DATA_SELECT_HEAD, selected);
+#if XPLANEUDP_METRICS
+    Metrics::add(stats.resubscribes);
+#endif
 }
 
 /**
@@ -190,50 +1125,112 @@ void XPlaneUdp::addDataref (const string &dataRef, const int32_t freq, const int
  * @param dataRef dataref 名称
  * @param value 值
  * @param index 目标为数组时的索引
+ * @param handler 可选的发送完成回调, 在 io 线程执行
  */
-void XPlaneUdp::setDataref (const std::string &dataRef, const float value, const int index) {
-    array<char, 509> buffer{};
+void XPlaneUdp::setDataref (const std::string &dataRef, const float value, const int index, SendHandler handler) {
+    if (DatarefCatalog::readOnly(dataRef)) {
+        rejectWrite(move(handler));
+        return;
+    }
     const string combineName{(index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef};
+    checkDrefName(combineName.size());
+    array<char, 509> buffer{};
     pack(buffer, 0, DATAREF_SET_HEAD, value, combineName, '\x00');
-    sendUdpData(buffer);
+    sendUdpData(buffer, move(handler));
 }
 
 /**
- * @brief 新增监听目标,目标为数组
+ * @brief 新增监听目标,目标为数组, 各元素与同名单个订阅共用 id 与引用计数
  * @param dataRef dataref 名称
- * @param length 数组长度
- * @param freq 频率, 0时停止
+ * @param length 数组长度, 数组已被订阅时须与已有长度相同, 否则抛出 invalid_argument;
+ * 各使用者按各自长度持有元素引用, 改变长度须先由全部使用者移除
+ * @param freq 频率, 0 时移除一个使用者, 见 removeDatarefArray
+ * @return 数组句柄, 移除时为空句柄; 元素名称放不进 RREF 请求时抛出 length_error
  */
-void XPlaneUdp::addDatarefArray (const std::string &dataRef, const int length, const int32_t freq) {
-    const string base = dataRef + '[';
+ArrayHandle<> XPlaneUdp::addDatarefArray (const std::string &dataRef, const int length, const int32_t freq) {
     if (freq == 0) { // 停止接收
-        for (int i = 0; i < length; ++i)
-            addDataref(base + to_string(i) + ']', 0);
-        unique_lock<shared_mutex> lock{datarefMutex};
-        dataref.right.erase(dataRef);
-        return;
-    } else { // 新建或者更改信息
-        unique_lock<shared_mutex> lock{arrayLengthMutex};
-        if (const auto ptr = arrayLength.find(dataRef); (ptr != arrayLength.end()) && (ptr->second != length)) { // 更改长度
-            const int32_t rawLength = ptr->second;
-            for (int i = 0; i < rawLength; ++i)
-                addDataref(base + to_string(i) + ']', 0);
-            unique_lock<shared_mutex> locky{datarefMutex};
-            dataref.right.erase(dataRef);
+        removeDatarefArray(dataRef, length, 0);
+        return {};
+    }
+    if (length > 0) // 最长的是末元素
+        checkRrefName(dataRef.size() + to_string(length - 1).size() + 2);
+    const string base = dataRef + '[';
+    vector<SubscriptionTable::Request> requests;
+    vector<int32_t> ids(length);
+    vector<const DatarefTable::Slot*> slots(length);
+    vector<const DatarefTable::Generation*> generations(length);
+    unique_lock<mutex> locky{datarefIndexMutex};
+    unique_lock<shared_mutex> elementsLock{arrayElementsMutex};
+    unique_lock<shared_mutex> lock{datarefMutex};
+    if (const auto it = arrayElements.find(dataRef); (it != arrayElements.end()) && (it->second.size() != ids.size()))
+        throw invalid_argument("Array already subscribed with a different length.");
+    // 本名与尚未订阅的元素一次分配连续的 id, 已订阅的元素沿用原 id
+    vector<string> names(length);
+    vector<int32_t> existing(length);
+    int32_t missing = subscriptions.find(dataRef).has_value() ? 0 : 1;
+    for (int i = 0; i < length; ++i) {
+        names[i] = base + to_string(i) + ']';
+        existing[i] = subscriptions.find(names[i]).value_or(-1);
+        missing += (existing[i] < 0) ? 1 : 0;
+    }
+    int32_t fresh = (missing > 0) ? allocateIds(missing) : -1;
+    const int32_t baseId = subscriptions.find(dataRef).value_or(-1);
+    const auto arrayChange = subscriptions.acquire(dataRef, (baseId < 0) ? fresh++ : baseId, freq, false); // 本名占一个 id
+    if (arrayChange.created) {
+        dataref.insert({arrayChange.id, dataRef});
+        indexCatalog(dataRef, arrayChange.id);
+    }
+    for (int i = 0; i < length; ++i) {
+        const string &datarefWithIndex = names[i];
+        const auto change = subscriptions.acquire(datarefWithIndex, (existing[i] < 0) ? fresh++ : existing[i], freq);
+        if (change.created) {
+            dataref.insert({change.id, datarefWithIndex});
+            indexCatalog(datarefWithIndex, change.id);
+            publishName(change.id, datarefWithIndex);
         }
-        arrayLength[dataRef] = length; // 然后修正长度
-    }
-    unique_lock<mutex> lock{datarefIndexMutex};
-    unique_lock<shared_mutex> locky{datarefMutex};
-    array<char, 413> buffer{};
-    dataref.insert({datarefIndex, dataRef});
-    for (int i = 1; i <= length; ++i) {
-        auto datarefWithIndex = base + to_string(i - 1) + ']';
-        dataref.insert({datarefIndex + i, datarefWithIndex});
-        pack(buffer, 0, DATAREF_GET_HEAD, freq, datarefIndex + i, datarefWithIndex);
-        sendUdpData(buffer);
+        if (change.request.has_value())
+            requests.push_back(change.request.value());
+        ids[i] = change.id;
+        slots[i] = latestDataref.slot(change.id);
+        generations[i] = latestDataref.generation(change.id);
+    }
+    if (auto &elements = arrayElements[dataRef]; elements != ids) {
+        elements = ids;
+        publishName(arrayChange.id, dataRef, length);
+        if (const int32_t entry = DatarefCatalog::find(dataRef); entry >= 0) // 超出编目长度的元素不在编目位置中
+            catalogLengths[entry].store((length <= DatarefCatalog::entry(entry).length) ? length : 0,
+                                        memory_order_release);
+    }
+    ArrayHandle<> handle{arrayChange.id, move(slots), move(generations)};
+    lock.unlock();
+    elementsLock.unlock();
+    sendRequests(requests);
+    return handle;
+}
+
+/**
+ * @brief 移除一个数组使用者, 各元素分别减少引用
+ * @param dataRef dataref 名称
+ * @param length 该使用者订阅时的数组长度
+ * @param freq 该使用者订阅时的频率, 0 时移除频率最低的使用者
+ */
+void XPlaneUdp::removeDatarefArray (const std::string &dataRef, const int length, const int32_t freq) {
+    const string base = dataRef + '[';
+    unique_lock<mutex> locky{datarefIndexMutex};
+    for (int i = 0; i < length; ++i)
+        releaseDataref(base + to_string(i) + ']', freq);
+    unique_lock<shared_mutex> elementsLock{arrayElementsMutex};
+    unique_lock<shared_mutex> lock{datarefMutex};
+    if (const auto change = subscriptions.release(dataRef, freq); change.erased) {
+        dataref.right.erase(dataRef);
+        indexCatalog(dataRef, -1);
+        arrayElements.erase(dataRef);
+        if (const int32_t entry = DatarefCatalog::find(dataRef); entry >= 0)
+            catalogLengths[entry].store(0, memory_order_release);
+        unpublishName(change.id, dataRef);
+        latestDataref.retire(change.id);
+        ids.discard(change.id, 1); // 本名从未向 XPlane 订阅, 无需隔离
     }
-    datarefIndex += (length + 1);
 }
 
 /**
@@ -242,27 +1239,110 @@ void XPlaneUdp::addDatarefArray (const std::string &dataRef, const int length, c
  * @return 数据组
  */
 optional<vector<float>> XPlaneUdp::getDatarefArray (const std::string &dataRef) {
-    const auto id = datarefArrayName2Id(dataRef);
-    if (!id.has_value())
-        return nullopt;
-    shared_lock<shared_mutex> lock{arrayLengthMutex};
-    const auto it = arrayLength.find(dataRef);
-    if (it == arrayLength.end())
+    if (const int32_t entry = DatarefCatalog::find(dataRef); entry >= 0)
+        return getDatarefArray(CatalogRef{entry});
+    return lookupArray(dataRef);
+}
+
+/**
+ * @brief 获取某组 dataref 最新值, 读入调用方提供的存储, 无分配
+ * @param dataRef dataref 名称
+ * @param out 输出区
+ * @param size 输出区长度
+ * @return 读出的元素个数, 未订阅、尚未收到或输出区不足时为空
+ */
+optional<size_t> XPlaneUdp::getDatarefArray (const std::string &dataRef, float* out, const size_t size) {
+    if (const int32_t entry = DatarefCatalog::find(dataRef); entry >= 0)
+        return getDatarefArray(CatalogRef{entry}, out, size);
+    return lookupArray(dataRef, out, size);
+}
+
+/**
+ * @brief 获取编目中某组 dataref 最新值, 不加锁
+ * @param ref 编目引用
+ * @return 数据组
+ */
+optional<vector<float>> XPlaneUdp::getDatarefArray (const CatalogRef ref) {
+    const int32_t slot = DatarefCatalog::slot(CatalogRef{ref.entry});
+    if (slot < 0)
         return nullopt;
-    const int32_t length = it->second;
-    lock.unlock();
+    const int32_t length = catalogLengths[ref.entry].load(memory_order_acquire);
+    if (length == 0) // 未订阅, 或订阅长度超出编目
+        return lookupArray(string(DatarefCatalog::entry(ref.entry).name));
     vector<float> container(length);
-    const int32_t startPos = id.value() + 1; // 本名占了一个
-    unique_lock<mutex> locky{latestDatarefMutex};
-    for (int i = 0; i < length; ++i) {
-        const auto that = latestDataref.find(startPos + i);
-        if (that == latestDataref.end())
-            return nullopt;
-        container[i] = that->second;
+    if (!readCatalog(slot, length, container.data()))
+        return nullopt;
+    return container;
+}
+
+/**
+ * @brief 获取编目中某组 dataref 最新值, 读入调用方提供的存储, 不加锁无分配
+ * @param ref 编目引用
+ * @param out 输出区
+ * @param size 输出区长度
+ * @return 读出的元素个数, 未订阅、尚未收到或输出区不足时为空
+ */
+optional<size_t> XPlaneUdp::getDatarefArray (const CatalogRef ref, float* out, const size_t size) {
+    const int32_t slot = DatarefCatalog::slot(CatalogRef{ref.entry});
+    if (slot < 0)
+        return nullopt;
+    const int32_t length = catalogLengths[ref.entry].load(memory_order_acquire);
+    if (length == 0)
+        return lookupArray(string(DatarefCatalog::entry(ref.entry).name), out, size);
+    if ((static_cast<size_t>(length) > size) || !readCatalog(slot, length, out))
+        return nullopt;
+    return length;
+}
+
+/**
+ * @brief 按编目位置依次读出数组元素
+ * @param slot 数组本名的编目位置
+ * @param length 订阅的数组长度
+ * @param out 输出区
+ * @return 任一元素尚未订阅或尚未收到时返回 false
+ */
+bool XPlaneUdp::readCatalog (const int32_t slot, const int32_t length, float* out) const {
+    for (int32_t i = 0; i < length; ++i) {
+        const auto id = catalogId(slot + 1 + i);
+        const auto value = id.has_value() ? latestDataref.load(id.value()) : nullopt;
+        if (!value.has_value())
+            return false;
+        out[i] = value.value();
     }
+    return true;
+}
+
+/**
+ * @brief 按名称查表获取某组 dataref 最新值
+ * @param dataRef dataref 名称
+ * @return 数据组
+ */
+optional<vector<float>> XPlaneUdp::lookupArray (const std::string &dataRef) {
+    shared_lock<shared_mutex> lock{arrayElementsMutex};
+    const auto it = arrayElements.find(dataRef);
+    if (it == arrayElements.end())
+        return nullopt;
+    vector<float> container(it->second.size());
+    if (!loadElements(latestDataref, it->second, container.data()))
+        return nullopt;
     return container;
 }
 
+/**
+ * @brief 按名称查表获取某组 dataref 最新值, 读入调用方提供的存储
+ * @param dataRef dataref 名称
+ * @param out 输出区
+ * @param size 输出区长度
+ * @return 读出的元素个数
+ */
+optional<size_t> XPlaneUdp::lookupArray (const std::string &dataRef, float* out, const size_t size) {
+    shared_lock<shared_mutex> lock{arrayElementsMutex};
+    const auto it = arrayElements.find(dataRef);
+    if ((it == arrayElements.end()) || (it->second.size() > size) || !loadElements(latestDataref, it->second, out))
+        return nullopt;
+    return it->second.size();
+}
+
 /**
  * @brief 获取某组 dataref 最新值
  * @param id dataref 索引
@@ -281,12 +1361,57 @@ optional<vector<float>> XPlaneUdp::getDatarefArray (const int32_t id) {
  * @brief 设置某组 dataref 值
  * @param dataRef dataref 名称
  * @param container 存放数据的容器
+ * @param handler 可选的回调, 全部元素发出后在 io 线程执行一次
  */
-void XPlaneUdp::setDatarefArray (const std::string &dataRef, const std::vector<float> &container) {
+void XPlaneUdp::setDatarefArray (const std::string &dataRef, const std::vector<float> &container,
+                                  SendHandler handler) {
+    if (!container.empty())
+        checkDrefName(dataRef.size() + to_string(container.size() - 1).size() + 2); // 最长的是末元素
+    if (DatarefCatalog::readOnly(dataRef)) {
+        rejectWrite(move(handler));
+        return;
+    }
+    const SendHandler each = joinHandler(container.size(), move(handler));
     array<char, 509> buffer{};
-    for (int i = 0; i < container.size(); ++i) {
-        pack(buffer, 0, DATAREF_SET_HEAD, container[i], dataRef + '[' + to_string(i) + ']', '\x00');
-        sendUdpData(buffer);
+    const size_t prefix = pack(buffer, 0, DATAREF_SET_HEAD, 0.0f, dataRef, '['); // 名称只编码一次
+    for (size_t i = 0; i < container.size(); ++i) {
+        pack(buffer, HEADER_LENGTH, container[i]);
+        char* end = to_chars(buffer.data() + prefix, buffer.data() + buffer.size(), i).ptr;
+        *end++ = ']';
+        *end = '\x00';
+        sendUdpData(buffer, each);
+    }
+}
+
+/**
+ * @brief 发送批量写入中的所有待发送值
+ * @param batch 批量写入, 发送后清空待发送值
+ * @param handler 可选的回调, 全部发出后在 io 线程执行一次, 含只读 dataref 时收到 permission_denied
+ */
+void XPlaneUdp::setDatarefBatch (DrefBatch &batch, SendHandler handler) {
+    const SendHandler each = joinHandler(batch.pending(), move(handler));
+    batch.take([&](const DrefBatch::Packet &packet) { sendUdpData(packet, each); },
+               [&] () { rejectWrite(each); });
+}
+
+/**
+ * @brief 一次设置多个 dataref 值
+ * @param values <名称, 值>, 只读 dataref 不发送
+ * @param handler 可选的回调, 全部发出后在 io 线程执行一次, 含只读 dataref 时收到 permission_denied
+ */
+void XPlaneUdp::setDatarefs (const std::vector<std::pair<std::string, float>> &values, SendHandler handler) {
+    for (const auto &item : values)
+        checkDrefName(item.first.size()); // 先检查全部, 不发出一半
+    const SendHandler each = joinHandler(values.size(), move(handler));
+    array<char, 509> buffer{};
+    for (const auto &[name, value] : values) {
+        if (DatarefCatalog::readOnly(name)) {
+            rejectWrite(each);
+            continue;
+        }
+        buffer.fill('\x00');
+        pack(buffer, 0, DATAREF_SET_HEAD, value, name);
+        sendUdpData(buffer, each);
     }
 }
 
@@ -304,10 +1429,11 @@ optional<int32_t> XPlaneUdp::datarefArrayName2Id (const std::string &dataRef) {
  * @param freq 接收频率
  */
 void XPlaneUdp::addBasicInfo (const int32_t freq) {
+    basicInfoFreq.store(freq);
     const string sentence = BASIC_INFO_HEAD + to_string(freq) + '\x00';
     vector<char> buffer(sentence.size());
     pack(buffer, 0, sentence);
-    sendUdpData(move(buffer));
+    sendUdpData(buffer);
 }
 
 /**
@@ -321,6 +1447,94 @@ optional<PlaneInfo> XPlaneUdp::getBasicInfo () {
     return latestBasicInfo;
 }
 
+/**
+ * @brief 某时刻的基本信息, 按最近两帧 RPOS 插值或外推, 供高于 RPOS 频率的显示使用
+ * @param time 时刻, 通常为当前时间或渲染帧的显示时间
+ * @return 基本信息
+ */
+optional<PlaneInfo> XPlaneUdp::getBasicInfoAt (const chrono::steady_clock::time_point time) {
+    if (!receivedInfo)
+        return nullopt;
+    unique_lock<mutex> lock(latestBasicInfoMutex);
+    return predictor->at(time);
+}
+
+/**
+ * @brief 外推到下一帧接收时间的误差统计
+ */
+PredictionErrors XPlaneUdp::getPredictionErrors () {
+    unique_lock<mutex> lock(latestBasicInfoMutex);
+    return predictor->errors();
+}
+
+/**
+ * @brief 选择 DATA 输出组, XPlane 按数据输出设置中的频率发送
+ * @param index 组序号, 即数据输出界面中的行号
+ * @return 组句柄, 序号越界时为空
+ */
+DataGroupHandle XPlaneUdp::addDataGroup (const int32_t index) {
+    return addDataGroups({index}).front();
+}
+
+/**
+ * @brief 批量选择 DATA 输出组, 合并为尽量少的 DSEL 包
+ * @param indices 组序号
+ * @return 与 indices 一一对应的组句柄, 序号越界的为空
+ */
+vector<DataGroupHandle> XPlaneUdp::addDataGroups (const vector<int32_t> &indices) {
+    vector<DataGroupHandle> handles;
+    vector<int32_t> selected;
+    for (const int32_t index : indices) {
+        const DataTable::Group* group = latestData.group(index);
+        handles.emplace_back(group == nullptr ? -1 : index, group);
+        if (group != nullptr)
+            selected.push_back(index);
+    }
+    unique_lock<mutex> lock{dataGroupsMutex};
+    dataGroups.insert(selected.begin(), selected.end());
+    lock.unlock();
+    selectDataGroups(DATA_SELECT_HEAD, selected);
+    return handles;
+}
+
+/**
+ * @brief 停止 DATA 输出组, 已收到的值仍可读
+ * @param index 组序号
+ */
+void XPlaneUdp::removeDataGroup (const int32_t index) {
+    unique_lock<mutex> lock{dataGroupsMutex};
+    if (dataGroups.erase(index) == 0)
+        return;
+    lock.unlock();
+    selectDataGroups(DATA_UNSELECT_HEAD, {index});
+}
+
+/**
+ * @brief 获取 DATA 组最新的 8 个值
+ * @param index 组序号
+ * @return 尚未收到时为空
+ */
+optional<DataTable::Values> XPlaneUdp::getDataGroup (const int32_t index) {
+    return latestData.load(index);
+}
+
+/**
+ * @brief 发送 DSEL/USEL, 组序号按单包容量分批
+ * @param head 指令头部
+ * @param indices 组序号
+ */
+void XPlaneUdp::selectDataGroups (const string &head, const vector<int32_t> &indices) {
+    constexpr size_t PER_PACKET{(SendQueue::PACKET_SIZE - HEADER_LENGTH) / sizeof(int32_t)};
+    for (size_t first = 0; first < indices.size(); first += PER_PACKET) {
+        const size_t count = min(PER_PACKET, indices.size() - first);
+        vector<char> buffer(HEADER_LENGTH + count * sizeof(int32_t));
+        size_t offset = pack(buffer, 0, head);
+        for (size_t i = first; i < first + count; ++i)
+            offset = pack(buffer, offset, indices[i]);
+        sendUdpData(buffer);
+    }
+}
+
 /**
  * @brief 获取某个 dataref 最新值
  * @param dataRef dataref 名称
@@ -339,11 +1553,45 @@ optional<float> XPlaneUdp::getDataref (const std::string &dataRef, const int ind
  * @return 最新值
  */
 optional<float> XPlaneUdp::getDataref (const int32_t id) {
-    unique_lock<mutex> lock{latestDatarefMutex};
-    const auto it = latestDataref.find(id);
-    if (it == latestDataref.end())
+    return latestDataref.load(id);
+}
+
+/**
+ * @brief 获取某个 dataref 最新值, 早于 maxAge 时视为过期
+ * @param id dataref 索引
+ * @param maxAge 可接受的最大年龄
+ * @return 最新值, 尚未收到或已过期时为空
+ */
+optional<float> XPlaneUdp::getDataref (const int32_t id, const chrono::nanoseconds maxAge) {
+    if (const auto age = getDatarefAge(id); !age.has_value() || (age.value() > maxAge))
+        return nullopt;
+    return latestDataref.load(id);
+}
+
+/**
+ * @brief 某个 dataref 最新值的年龄, 由槽位中的包序号换算, 不加锁
+ * @param id dataref 索引
+ * @return 尚未收到, 或早于时间环 (PacketClock::SIZE 个包之前) 时为空
+ */
+optional<chrono::nanoseconds> XPlaneUdp::getDatarefAge (const int32_t id) {
+    const DatarefTable::Slot* slot = latestDataref.slot(id);
+    if (slot == nullptr)
+        return nullopt;
+    const auto time = packetClock.time(DatarefTable::decodeSerial(slot->load(memory_order_acquire)));
+    if (!time.has_value())
         return nullopt;
-    return it->second;
+    const int64_t now = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+    return chrono::nanoseconds(max<int64_t>(0, now - *time));
+}
+
+/**
+ * @brief 各订阅的请求频率、实测频率、最新值年龄与是否停更, 为最近一次健康检查 (每 DatarefHealth::PERIOD) 的结果
+ * @return 按 id 排序
+ */
+vector<DatarefStatus> XPlaneUdp::getDatarefHealth () {
+    lock_guard<mutex> lock{healthMutex};
+    return healthStatus;
 }
 
 /**
@@ -353,6 +1601,8 @@ optional<float> XPlaneUdp::getDataref (const int32_t id) {
  * @return 唯一 id
  */
 optional<int32_t> XPlaneUdp::datarefName2Id (const std::string &dataRef, const int index) {
+    if (const int32_t slot = DatarefCatalog::slot(dataRef, index); slot >= 0) // 编目中的名称不加锁也不拼接
+        return catalogId(slot);
     const string combineName{(index != -1) ? (dataRef + '[' + to_string(index) + ']') : dataRef};
     shared_lock<shared_mutex> lock{datarefMutex};
     const auto it = dataref.right.find(combineName);
@@ -360,3 +1610,111 @@ optional<int32_t> XPlaneUdp::datarefName2Id (const std::string &dataRef, const i
         return nullopt;
     return it->get_left();
 }
+
+/**
+ * @brief 在编目 id 表中登记或移除名称, 不在编目中的名称忽略, 调用方持有 datarefMutex
+ * @param name 完整名称, 数组元素带下标
+ * @param id 订阅 id, -1 为移除
+ */
+void XPlaneUdp::indexCatalog (const string &name, const int32_t id) {
+    if (const int32_t slot = DatarefCatalog::slotOf(name); slot >= 0)
+        catalogIds[slot].store(id + 1, memory_order_release);
+}
+
+/**
+ * @brief 编目位置上的订阅 id, 不加锁
+ * @param slot 编目位置
+ * @return 未订阅时为空
+ */
+optional<int32_t> XPlaneUdp::catalogId (const int32_t slot) const {
+    const int32_t id = catalogIds[slot].load(memory_order_acquire) - 1;
+    if (id < 0)
+        return nullopt;
+    return id;
+}
+
+/**
+ * @brief 只读 dataref 不发送, 回调收到 permission_denied
+ */
+void XPlaneUdp::rejectWrite (SendHandler handler) {
+    if (handler)
+        asio::post(strand_, [handler = move(handler)] () {
+            handler(sys::errc::make_error_code(sys::errc::permission_denied));
+        });
+}
+
+/**
+ * @brief 新增监听目标, 目标在编目中
+ * @param ref 编目引用, 数组元素用 ref[i]
+ * @param freq 频率, 0 时移除一个使用者
+ * @return 订阅句柄
+ */
+DatarefHandle<> XPlaneUdp::addDataref (const CatalogRef ref, const int32_t freq) {
+    return addDataref(string(DatarefCatalog::entry(ref.entry).name), freq, ref.index);
+}
+
+/**
+ * @brief 获取编目中某个 dataref 最新值, 不加锁
+ * @param ref 编目引用
+ * @return 最新值
+ */
+optional<float> XPlaneUdp::getDataref (const CatalogRef ref) {
+    if (const auto id = datarefName2Id(ref); id.has_value())
+        return getDataref(id.value());
+    return nullopt;
+}
+
+/**
+ * @brief 设置编目中某个 dataref 的值, 只读时不发送
+ * @param ref 编目引用
+ * @param value 值
+ * @param handler 可选的发送完成回调, 在 io 线程执行, 只读时收到 permission_denied
+ */
+void XPlaneUdp::setDataref (const CatalogRef ref, const float value, SendHandler handler) {
+    setDataref(string(DatarefCatalog::entry(ref.entry).name), value, ref.index, move(handler));
+}
+
+/**
+ * @brief 移除编目中某个 dataref 的一个使用者
+ * @param ref 编目引用
+ * @param freq 该使用者订阅时的频率
+ */
+void XPlaneUdp::removeDataref (const CatalogRef ref, const int32_t freq) {
+    removeDataref(string(DatarefCatalog::entry(ref.entry).name), freq, ref.index);
+}
+
+/**
+ * @brief 编目中 dataref 的唯一 id, 不加锁
+ * @param ref 编目引用
+ * @return 唯一 id
+ */
+optional<int32_t> XPlaneUdp::datarefName2Id (const CatalogRef ref) {
+    if (const int32_t slot = DatarefCatalog::slot(ref); slot >= 0)
+        return catalogId(slot);
+    if (ref.entry < 0)
+        return nullopt;
+    return datarefName2Id(string(DatarefCatalog::entry(ref.entry).name), ref.index); // 下标超出编目长度
+}
+
+/**
+ * @brief 新增监听目标, 目标为编目中的数组, 长度取自编目
+ * @param ref 编目引用
+ * @param freq 频率, 0 时移除一个使用者
+ * @return 数组句柄
+ */
+ArrayHandle<> XPlaneUdp::addDatarefArray (const CatalogRef ref, const int32_t freq) {
+    const CatalogEntry &entry = DatarefCatalog::entry(ref.entry);
+    if (entry.length == 0)
+        throw invalid_argument("Dataref is not an array.");
+    return addDatarefArray(string(entry.name), entry.length, freq);
+}
+
+/**
+ * @brief 移除编目中数组的一个使用者
+ * @param ref 编目引用
+ * @param freq 该使用者订阅时的频率
+ */
+void XPlaneUdp::removeDatarefArray (const CatalogRef ref, const int32_t freq) {
+    const CatalogEntry &entry = DatarefCatalog::entry(ref.entry);
+    removeDatarefArray(string(entry.name), entry.length, freq);
+}
@@ -6,13 +6,34 @@
 #include <string>
 #include <exception>
 #include <boost/asio/steady_timer.hpp>
-#include <boost/system.hpp>
+#include <boost/system/error_code.hpp>
 #include <boost/asio.hpp>
 #include <boost/bimap.hpp>
+#include <deque>
 #include <map>
+#include <set>
 #include <thread>
+#include <condition_variable>
 #include <mutex>
 #include <shared_mutex>
+#include "DatarefTable.hpp"
+#include "DatarefHandle.hpp"
+#include "DatarefGroup.hpp"
+#include "DatarefHistory.hpp"
+#include "DatarefWatch.hpp"
+#include "PacketRing.hpp"
+#include "SendQueue.hpp"
+#include "DrefBatch.hpp"
+#include "XPlaneCapture.hpp"
+#include "XPlaneRecorder.hpp"
+#include "Metrics.hpp"
+#include "RrefDecoder.hpp"
+#include "DataTable.hpp"
+#include "Subscriptions.hpp"
+#include "IdAllocator.hpp"
+#include "DatarefCatalog.hpp"
+#include "DatarefHealth.hpp"
+#include "PacketClock.hpp"
 
 
 namespace sys = boost::system;
@@ -44,6 +65,19 @@ struct PlaneInfo { // double8字节下无填充
     float rollRate, pitchRate, yawRate; // 横滚 俯仰 偏航
 };
 
+struct XPlaneBeacon { // BECN 多播内容
+    uint8_t mainVer, minorVer; // 信标版本
+    int32_t software; // 1 为 XPlane
+    int32_t xpVer; // XPlane 版本
+    uint32_t role; // 1 主机 2 外部视景 3 IOS
+    uint16_t port; // 接收 UDP 的端口
+    std::string hostname;
+};
+
+class SharedPublisher;
+class XPlaneEngine;
+class PlanePredictor;
+
 class XPlaneIpNotFound final : public std::exception {
     public:
         [[nodiscard]] const char* what () const noexcept override {
@@ -68,71 +102,346 @@ class XPlaneVersionNotSupported final : public std::exception {
 class XPlaneUdp {
     inline const static std::string MULTI_CAST_GROUP{"239.255.1.1"};
     static constexpr unsigned short MULTI_CAST_PORT{49707};
+    friend class XPlaneUdpBench; // 基准测试在 io 线程上直接驱动解析
+    friend class XPlaneEngine; // 共享线程池转发 BECN
     public:
         // 默认
         XPlaneUdp ();
+        explicit XPlaneUdp (const ip::udp::endpoint &endpoint, bool discover = true);
+        explicit XPlaneUdp (const std::string &cache);
+        XPlaneUdp (XPlaneEngine &engine, const ip::udp::endpoint &endpoint);
         ~XPlaneUdp ();
         // 状态
         void close ();
         bool getState ();
+        ip::udp::endpoint endpoint ();
+        static std::optional<XPlaneBeacon> parseBeacon (std::string_view packet);
+        MetricsSnapshot metrics ();
         // dataref
-        void addDataref (const std::string &dataRef, int32_t freq = 1, int index = -1);
+        DatarefHandle<> addDataref (const std::string &dataRef, int32_t freq = 1, int index = -1);
         std::optional<float> getDataref (const std::string &dataRef, int index = -1);
         std::optional<float> getDataref (int32_t id);
-        void setDataref (const std::string &dataRef, float value, int index = -1);
+        std::optional<float> getDataref (int32_t id, std::chrono::nanoseconds maxAge);
+        std::optional<std::chrono::nanoseconds> getDatarefAge (int32_t id);
+        std::vector<DatarefStatus> getDatarefHealth ();
+        void setDataref (const std::string &dataRef, float value, int index = -1, SendHandler handler = nullptr);
+        void removeDataref (const std::string &dataRef, int32_t freq, int index = -1);
         std::optional<int32_t> datarefName2Id (const std::string &dataRef, int index = -1);
-        void addDatarefArray (const std::string &dataRef, int length, int32_t freq = 1);
+        ArrayHandle<> addDatarefArray (const std::string &dataRef, int length, int32_t freq = 1);
+        void removeDatarefArray (const std::string &dataRef, int length, int32_t freq);
+        template <size_t N>
+        ArrayHandle<N> addDatarefArray (const std::string &dataRef, int32_t freq = 1);
         std::optional<std::vector<float>> getDatarefArray (const std::string &dataRef);
+        std::optional<size_t> getDatarefArray (const std::string &dataRef, float* out, size_t size);
+        template <size_t M>
+        std::optional<size_t> getDatarefArray (const std::string &dataRef, std::array<float, M> &out);
         std::optional<std::vector<float>> getDatarefArray (int32_t id);
-        void setDatarefArray (const std::string &dataRef, const std::vector<float> &container);
+        void setDatarefArray (const std::string &dataRef, const std::vector<float> &container,
+                              SendHandler handler = nullptr);
         std::optional<int32_t> datarefArrayName2Id (const std::string &dataRef);
+        void setDatarefBatch (DrefBatch &batch, SendHandler handler = nullptr);
+        void setDatarefs (const std::vector<std::pair<std::string, float>> &values, SendHandler handler = nullptr);
+        // 编目中的 dataref, 名称与数组长度取自编目
+        DatarefHandle<> addDataref (CatalogRef ref, int32_t freq = 1);
+        std::optional<float> getDataref (CatalogRef ref);
+        void setDataref (CatalogRef ref, float value, SendHandler handler = nullptr);
+        void removeDataref (CatalogRef ref, int32_t freq);
+        std::optional<int32_t> datarefName2Id (CatalogRef ref);
+        ArrayHandle<> addDatarefArray (CatalogRef ref, int32_t freq = 1);
+        void removeDatarefArray (CatalogRef ref, int32_t freq);
+        std::optional<std::vector<float>> getDatarefArray (CatalogRef ref);
+        std::optional<size_t> getDatarefArray (CatalogRef ref, float* out, size_t size);
+        template <size_t M>
+        std::optional<size_t> getDatarefArray (CatalogRef ref, std::array<float, M> &out);
+        template <typename S>
+        DatarefGroup<S> addDatarefGroup (const std::vector<GroupField<S>> &fields, int32_t freq = 1);
+        template <typename S>
+        void removeDatarefGroup (const DatarefGroup<S> &group);
+        DatarefHistory enableHistory (const DatarefHandle<> &handle, size_t capacity = 1024);
+        void disableHistory (const DatarefHistory &history);
+        // 更新通知
+        DatarefWatch onUpdate (const DatarefHandle<> &handle, UpdateCallback callback, float deadband = -1,
+                               const asio::any_io_executor &executor = {});
+        template <typename S>
+        DatarefWatch onUpdate (const DatarefGroup<S> &group, std::function<void (const S &)> callback,
+                               float deadband = -1, const asio::any_io_executor &executor = {});
+        void removeWatch (const DatarefWatch &watch);
+        std::optional<float> waitForUpdate (const DatarefHandle<> &handle, std::chrono::steady_clock::time_point deadline,
+                                            float deadband = -1);
+        template <typename S>
+        std::optional<S> waitForUpdate (const DatarefGroup<S> &group, std::chrono::steady_clock::time_point deadline);
+        // 抓包
+        void startCapture (const std::string &path);
+        void stopCapture ();
+        // 飞行记录
+        void startRecording (const std::string &path);
+        uint64_t stopRecording ();
+        // 共享内存
+        void startSharedMemory (const std::string &name, uint32_t slots = 1 << 16, uint32_t names = 1 << 14);
+        void stopSharedMemory ();
         // 基本信息
         void addBasicInfo (int32_t freq = 1);
         std::optional<PlaneInfo> getBasicInfo ();
+        std::optional<PlaneInfo> getBasicInfoAt (std::chrono::steady_clock::time_point time);
+        PredictionErrors getPredictionErrors ();
+        // DATA 输出
+        DataGroupHandle addDataGroup (int32_t index);
+        std::vector<DataGroupHandle> addDataGroups (const std::vector<int32_t> &indices);
+        void removeDataGroup (int32_t index);
+        std::optional<DataTable::Values> getDataGroup (int32_t index);
     private:
         // dataref
-        std::atomic<int32_t> datarefIndex{0}; // dataref 索引
-        std::map<int, float> latestDataref; // 最新 dataref 数据
+        std::atomic<int32_t> datarefIndex{0}; // 已分配 id 上限, 解码时不小于它的 id 视为未订阅
+        IdAllocator ids{DatarefTable::CHUNK_SIZE, DatarefTable::CAPACITY}; // 与 dataref 一同由 datarefMutex 保护
+        DatarefTable latestDataref; // 最新 dataref 数据, 按 id 稠密存放
+        uint32_t packetSerial{0}; // RREF 包序号, 仅 io 线程使用
+        PacketClock packetClock; // 包序号 -> 接收时间, io 线程写入
+        DatarefHealth health; // 订阅健康检查, 仅 io 线程使用
+        std::vector<DatarefStatus> healthStatus; // 最近一次健康检查的结果, 由 healthMutex 保护
         boost::bimap<int32_t, std::string> dataref; // 双映射 dataref <索引,名称>
-        std::unordered_map<std::string, int32_t> arrayLength; // 数组长度
+        std::unordered_map<std::string, std::vector<int32_t>> arrayElements; // 数组本名 -> 各元素 id
+        SubscriptionTable subscriptions; // 订阅引用计数, 与 dataref 一同由 datarefMutex 保护
+        std::unique_ptr<std::atomic<int32_t>[]> catalogIds{std::make_unique<std::atomic<int32_t>[]>(
+            DatarefCatalog::SLOTS)}; // 编目位置 -> id + 1, 0 为未订阅; 与 dataref 一同写入, 读取无锁
+        std::unique_ptr<std::atomic<int32_t>[]> catalogLengths{std::make_unique<std::atomic<int32_t>[]>(
+            DatarefCatalog::size())}; // 编目条目 -> 已订阅的数组长度, 0 为未订阅或超出编目长度
+        std::vector<std::shared_ptr<GroupCore>> groups; // dataref 组, 仅 io 线程使用
+        std::vector<std::shared_ptr<HistoryRing>> histories; // 历史环, 仅 io 线程使用
+        std::vector<std::shared_ptr<WatchCore>> watches; // 更新通知, 仅 io 线程使用
+        std::atomic<int32_t> waiters{0}; // 阻塞等待中的线程数, 为 0 时 io 线程不唤醒
         // 基本信息
         PlaneInfo latestBasicInfo{};
         std::atomic<bool> receivedInfo{false};
+        std::unique_ptr<PlanePredictor> predictor; // RPOS 航位推算, 与最新值一同由 latestBasicInfoMutex 保护
+        std::atomic<int32_t> basicInfoFreq{0}; // 最近一次请求的 RPOS 频率, 重新订阅用
+        // DATA 输出
+        DataTable latestData; // 按组序号存放
+        std::set<int32_t> dataGroups; // 已选择输出的组
         // 网络
-        asio::io_context io_context{}; // 上下文
+        std::unique_ptr<asio::io_context> ownContext{std::make_unique<asio::io_context>()}; // 独立运行时自有的上下文
+        asio::io_context &io_context{*ownContext}; // 上下文, 共享线程池时为引擎的上下文
+        XPlaneEngine* engine{nullptr}; // 共享线程池, 为空时独占 io 线程
+        std::atomic<int32_t> pendingOps{0}; // 已发起未完成的常驻异步操作, 共享线程池下关闭时等待归零
+        std::mutex settleMutex; // 锁
+        std::condition_variable settleSignal; // pendingOps 归零或确认任务执行时唤醒
         ip::udp::socket localSocket; // 绑定了本地地址的 socket
-        ip::udp::endpoint remoteEndpoint; // xp 地址
+        ip::udp::endpoint remoteEndpoint; // xp 地址, 仅 io 线程修改
+        ip::udp::socket beaconSocket; // 后台发现, 仅 io 线程使用
+        UdpBuffer beaconBuffer{};
+        ip::udp::endpoint beaconSender{};
+        std::string endpointCache; // 最近一次发现的地址缓存文件, 为空时不缓存
+        bool hasEndpoint{false}; // 已知 xp 地址
+        bool connected{false}; // 当前地址收到过数据, 仅 io 线程使用
         std::atomic<bool> timeout{false};
+        PacketRing receiveRing{}; // 接收环, 仅 io 线程使用
+        asio::steady_timer watchdog; // 超时看门狗, 仅在到期时重新设定
+        std::chrono::steady_clock::time_point lastReceive{}; // 最近一次收到数据的时间, 仅 io 线程使用
+        SendQueue sendQueue{}; // 待发送包, 由 io 线程批量发出
+        std::atomic<bool> sendScheduled{false}; // 是否已安排 io 线程清空发送队列
+        std::deque<SendQueue::Packet> sendOverflow; // 队列满时 io 线程入队的包, 按序接在队列之后, 仅 io 线程使用
+        bool writeWaiting{false}; // 已在等待 socket 可写, 仅 io 线程使用
+        std::unique_ptr<CaptureWriter> capture; // 抓包, 仅 io 线程使用
+        std::unique_ptr<RecordWriter> recorder; // 飞行记录, 仅 io 线程使用
+        std::atomic<bool> recording{false}; // 记录中, 名称变化需转交 io 线程
+        std::shared_ptr<SharedPublisher> shared; // 共享内存发布, 名称目录由订阅线程写入
+        std::shared_ptr<SharedPublisher> sharedIo; // 同一发布者, 仅 io 线程使用
+        int64_t receiveTime{0}; // 当前数据报的接收时间 ns, 仅 io 线程使用
+#if XPLANEUDP_METRICS
+        Metrics stats; // 运行统计, io 线程写入
+#endif
         // 多线程
         std::thread ioThread;
         std::atomic<bool> runThread{true}; // 线程终止循环
         Strand strand_; // udp协调
-        std::mutex latestDatarefMutex; // 锁
         std::shared_mutex datarefMutex; // 读写锁
         std::mutex latestBasicInfoMutex; // 锁
-        std::shared_mutex arrayLengthMutex; // 读写锁
-        std::mutex datarefIndexMutex; // 锁
+        std::mutex dataGroupsMutex; // 锁
+        std::mutex sharedMutex; // 锁
+        std::mutex endpointMutex; // 锁, io 线程修改地址与其他线程读取之间
+        std::shared_mutex arrayElementsMutex; // 读写锁
+        std::mutex datarefIndexMutex; // 订阅变更锁, 保证请求按变更顺序发出
+        std::mutex updateMutex; // 等待更新锁
+        std::condition_variable updateSignal; // 每批数据处理完后唤醒等待者
+        std::mutex healthMutex; // 锁
 
         // 网络
+        void open ();
         void autoUdpFind ();
+        static void joinMulticast (ip::udp::socket &socket);
+        void armDiscovery ();
+        void handleBeacon (const ip::udp::endpoint &found);
+        void settle ();
+        void finishOp ();
+        void switchEndpoint (const ip::udp::endpoint &found);
         void startReceive ();
-        void handleReceive (std::vector<char> received);
+        void handleReceive (std::string_view received);
+        void selectDataGroups (const std::string &head, const std::vector<int32_t> &indices);
+        void armReceive ();
+        void armWatchdog (std::chrono::steady_clock::time_point deadline);
+        void checkHealth (std::chrono::steady_clock::time_point now);
+        void publishName (int32_t id, const std::string &name, int32_t length = 0);
+        void unpublishName (int32_t id, const std::string &name);
+        int32_t allocateIds (int32_t count);
+        void releaseDataref (const std::string &name, int32_t freq);
+        void indexCatalog (const std::string &name, int32_t id);
+        std::optional<int32_t> catalogId (int32_t slot) const;
+        std::optional<std::vector<float>> lookupArray (const std::string &dataRef);
+        std::optional<size_t> lookupArray (const std::string &dataRef, float* out, size_t size);
+        bool readCatalog (int32_t slot, int32_t length, float* out) const;
+        void rejectWrite (SendHandler handler);
+        void sendRequests (const std::vector<SubscriptionTable::Request> &requests);
+        void resubscribe ();
+        void registerGroup (std::shared_ptr<GroupCore> core);
+        void unregisterGroup (std::shared_ptr<GroupCore> core);
+        DatarefWatch registerWatch (std::vector<DatarefHandle<>> members, float deadband, WatchCore::Fire fire);
+        bool waitUntil (const std::function<bool ()> &ready, std::chrono::steady_clock::time_point deadline);
+        void notifyUpdate ();
+        void drainSendQueue ();
+        size_t sendBatch (SendQueue::Packet** packets, size_t count);
         template <typename T>
-        void sendUdpData (T buffer);
+        void sendUdpData (const T &buffer, SendHandler handler = nullptr);
         template <typename T>
         size_t receiveUdpData (T &buffer, ip::udp::socket &socket, ip::udp::endpoint &sender, int timeout);
 };
 /**
- * @brief 通过 UDP 异步发送数据
+ * @brief 新增监听目标,目标为定长数组
+ * @tparam N 数组长度
+ * @param dataRef dataref 名称
+ * @param freq 频率, 0时停止
+ * @return 定长数组句柄
+ */
+template <size_t N>
+ArrayHandle<N> XPlaneUdp::addDatarefArray (const std::string &dataRef, const int32_t freq) {
+    static_assert(N > 0, "Array length must be positive.");
+    const ArrayHandle<> handle = addDatarefArray(dataRef, static_cast<int>(N), freq);
+    if (!handle)
+        return {};
+    return ArrayHandle<N>{handle};
+}
+
+/**
+ * @brief 获取某组 dataref 最新值, 读入定长数组, 无分配
+ * @param dataRef dataref 名称
+ * @param out 输出数组, 不短于订阅的长度
+ * @return 读出的元素个数
+ */
+template <size_t M>
+std::optional<size_t> XPlaneUdp::getDatarefArray (const std::string &dataRef, std::array<float, M> &out) {
+    return getDatarefArray(dataRef, out.data(), M);
+}
+
+/**
+ * @brief 获取编目中某组 dataref 最新值, 读入定长数组, 不加锁无分配
+ * @param ref 编目引用
+ * @param out 输出数组, 不短于订阅的长度
+ * @return 读出的元素个数
+ */
+template <size_t M>
+std::optional<size_t> XPlaneUdp::getDatarefArray (const CatalogRef ref, std::array<float, M> &out) {
+    return getDatarefArray(ref, out.data(), M);
+}
+
+/**
+ * @brief 新增 dataref 组, 组内成员以一致快照整体读出
+ * @tparam S 用户结构体
+ * @param fields 字段与 dataref 的映射
+ * @param freq 频率
+ * @return 组句柄, 订阅生效并收齐所有成员后可读
+ */
+template <typename S>
+DatarefGroup<S> XPlaneUdp::addDatarefGroup (const std::vector<GroupField<S>> &fields, const int32_t freq) {
+    if (fields.empty() || (freq <= 0))
+        return {};
+    std::vector<GroupCore::Field> layout;
+    layout.reserve(fields.size());
+    for (const auto &field : fields)
+        layout.push_back({field.dataRef, field.index, addDataref(field.dataRef, freq, field.index), field.offset,
+                          field.type});
+    auto core = std::make_shared<GroupCore>(sizeof(S), std::move(layout), freq);
+    registerGroup(core);
+    return DatarefGroup<S>{std::move(core)};
+}
+
+/**
+ * @brief 停止发布 dataref 组并退订组持有的成员订阅, 其他使用者的同名订阅不受影响; 重复移除无效果
+ * @param group 组句柄
+ */
+template <typename S>
+void XPlaneUdp::removeDatarefGroup (const DatarefGroup<S> &group) {
+    if (group)
+        unregisterGroup(group.handle());
+}
+
+/**
+ * @brief dataref 组更新时回调, 组内成员收齐且有成员更新后触发, 回调收到与 get() 相同的一致快照
+ * @tparam S 用户结构体
+ * @param group 组句柄
+ * @param callback 回调
+ * @param deadband 过滤阈值, 小于 0 每批都通知, 0 时有成员值变化才通知, 大于 0 时有成员变化超过阈值才通知
+ * @param executor 执行回调的执行器, 为空时直接在 io 线程执行
+ * @return 通知句柄, 句柄无效时为空
+ */
+template <typename S>
+DatarefWatch XPlaneUdp::onUpdate (const DatarefGroup<S> &group, std::function<void (const S &)> callback,
+                                  const float deadband, const asio::any_io_executor &executor) {
+    if (!group || !callback)
+        return {};
+    return registerWatch(group.handle()->members(), deadband,
+                         [group, callback = std::move(callback), executor] (uint32_t) {
+                             S snapshot;
+                             if (!group.read(snapshot)) // 组在同一批中先于通知发布, 此时快照已是最新
+                                 return;
+                             if (executor)
+                                 asio::post(executor, [callback, snapshot] () { callback(snapshot); });
+                             else
+                                 callback(snapshot);
+                         });
+}
+
+/**
+ * @brief 阻塞等待 dataref 组发布新的快照
+ * @param group 组句柄
+ * @param deadline 截止时间
+ * @return 新快照, 超时为空
+ */
+template <typename S>
+std::optional<S> XPlaneUdp::waitForUpdate (const DatarefGroup<S> &group, const std::chrono::steady_clock::time_point deadline) {
+    if (!group)
+        return std::nullopt;
+    const uint32_t seen = group.serial();
+    std::optional<S> result;
+    waitUntil([&] () {
+        if (group.serial() == seen)
+            return false;
+        result = group.get();
+        return result.has_value();
+    }, deadline);
+    return result;
+}
+
+/**
+ * @brief 通过 UDP 异步发送数据, 入队后立即返回, 由 io 线程发出
+ * 队列满时其他线程等待 io 线程腾出位置, io 线程自身不等待, 转入溢出列表
  * @param buffer 缓冲区 array<char, N>
+ * @param handler 可选的发送完成回调, 在 io 线程执行
  */
 template <typename T>
-void XPlaneUdp::sendUdpData (T buffer) {
-    asio::post(strand_, [this, copyBuffer=move(buffer)] () {
-        localSocket.async_send_to(asio::buffer(copyBuffer), remoteEndpoint, asio::bind_executor(strand_,
-                                      [](const sys::error_code &, std::size_t)-> void {}));
-    });
-    io_context.poll();
+void XPlaneUdp::sendUdpData (const T &buffer, SendHandler handler) {
+    if (strand_.running_in_this_thread()) {
+        if (!sendOverflow.empty() || !sendQueue.push(buffer.data(), buffer.size(), handler)) { // 已溢出时保持顺序
+            if (buffer.size() > SendQueue::PACKET_SIZE)
+                throw std::length_error("Packet too large for SendQueue.");
+            auto &packet = sendOverflow.emplace_back();
+            std::copy(buffer.begin(), buffer.end(), packet.data.begin());
+            packet.size = buffer.size();
+            packet.handler = std::move(handler);
+        }
+    } else {
+        while (!sendQueue.push(buffer.data(), buffer.size(), handler)) // 队列满
+            std::this_thread::yield();
+    }
+    if (!sendScheduled.exchange(true))
+        asio::post(strand_, [this] () { drainSendQueue(); });
 }
 /**
  * @brief 定时阻塞接收 UDP 数据
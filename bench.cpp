@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <numeric>
+#include <random>
+#include "XPlaneEngine.hpp"
+#include "XPlaneShared.hpp"
+#include "XPlaneSim.hpp"
+
+// 用法: XPlaneUDPBench [结果文件]
+// 在本机启动 XPlaneSim 作为对端, 结果以 JSON Lines 输出 (默认标准输出), 每行一项测量
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+/**
+ * @brief JSON Lines 结果输出
+ */
+class Report {
+    public:
+        struct Field {
+            string key;
+            double value;
+
+            template <typename T>
+            Field (string key, const T value): key(move(key)), value(static_cast<double>(value)) {}
+        };
+
+        explicit Report (ostream &out): out(out) {}
+
+        void line (const string &bench, const vector<Field> &fields) {
+            out << "{\"bench\":\"" << bench << '"';
+            for (const auto &[key, value] : fields)
+                out << ",\"" << key << "\":" << setprecision(10) << value;
+            out << '}' << endl;
+        }
+    private:
+        ostream &out;
+};
+
+static double nanosecondsSince (const Clock::time_point start) {
+    return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+class XPlaneUdpBench {
+    public:
+        XPlaneUdpBench (XPlaneUdp &xp, Report &report): xp(xp), report(report) {}
+
+        /**
+         * @brief handleReceive 解析速率, 在 io 线程上执行以免与接收链竞争
+         */
+        void parse () {
+            constexpr size_t MAX_PAIRS{183};
+            vector<int32_t> ids;
+            for (size_t i = 0; i < MAX_PAIRS; ++i)
+                ids.push_back(xp.addDataref("bench/parse/" + to_string(i)).id());
+            for (const size_t pairs : {1, 16, 64, 183}) {
+                UdpBuffer buffer{};
+                size_t length = pack(buffer, 0, string{"RREF", 5});
+                for (size_t i = 0; i < pairs; ++i)
+                    length = pack(buffer, length, ids[i], static_cast<float>(i));
+                const string_view packet{buffer.data(), length};
+                const size_t iterations = max<size_t>(100000, 20000000 / pairs);
+                const double elapsed = onIo([&] () {
+                    for (size_t i = 0; i < iterations; ++i)
+                        xp.handleReceive(packet);
+                });
+                report.line("parse_rref", {
+                                {"pairs", pairs}, {"packets", iterations},
+                                {"ns_per_packet", elapsed / iterations},
+                                {"ns_per_pair", elapsed / iterations / pairs},
+                                {"packets_per_s", iterations * 1e9 / elapsed}
+                            });
+            }
+            PlaneInfo info{};
+            info.lon = 120;
+            info.lat = 30;
+            info.alt = 1000;
+            array<char, 5 + sizeof(PlaneInfo)> buffer{};
+            pack(buffer, 0, string{"RPOS", 5}, info);
+            const string_view packet{buffer.data(), buffer.size()};
+            constexpr size_t iterations{2000000};
+            const double elapsed = onIo([&] () {
+                for (size_t i = 0; i < iterations; ++i)
+                    xp.handleReceive(packet);
+            });
+            report.line("parse_rpos", {
+                            {"packets", iterations}, {"ns_per_packet", elapsed / iterations},
+                            {"packets_per_s", iterations * 1e9 / elapsed}
+                        });
+            parseData();
+        }
+
+        /**
+         * @brief DATA 解析速率, 单个数据报 40 组共 320 个值
+         */
+        void parseData () {
+            constexpr int32_t RECORDS{40};
+            UdpBuffer buffer{};
+            size_t length = pack(buffer, 0, string{"DATA*", 5});
+            for (int32_t index = 0; index < RECORDS; ++index) {
+                length = pack(buffer, length, index);
+                for (int k = 0; k < 8; ++k)
+                    length = pack(buffer, length, static_cast<float>(index * 10 + k));
+            }
+            const string_view packet{buffer.data(), length};
+            constexpr size_t iterations{500000};
+            const double elapsed = onIo([&] () {
+                for (size_t i = 0; i < iterations; ++i)
+                    xp.handleReceive(packet);
+            });
+            report.line("parse_data", {
+                            {"records", RECORDS}, {"packets", iterations},
+                            {"ns_per_packet", elapsed / iterations},
+                            {"ns_per_value", elapsed / iterations / (RECORDS * 8)},
+                            {"packets_per_s", iterations * 1e9 / elapsed}
+                        });
+        }
+
+        /**
+         * @brief RREF 解码器: 先与逐对写入的原实现逐字节比对, 再测量每秒数据对数
+         * @return 结果一致
+         */
+        bool decode () {
+            constexpr int32_t LIMIT{6000}; // 跨越两个块
+            const auto ignore = [](int32_t, const DatarefTable::Slot &) {};
+            const auto legacy = [](const string_view pairs, DatarefTable &table, const int32_t limit,
+                                   const uint32_t serial) {
+                for (size_t i = 0; i + 8 <= pairs.size(); i += 8) {
+                    int32_t id;
+                    float value;
+                    unpack(pairs, i, id, value);
+                    if ((id >= 0) && (id < limit))
+                        table.store(id, value, serial);
+                }
+            };
+            DatarefTable vector, scalar, reference;
+            for (int32_t id = 0; id < LIMIT; ++id) {
+                vector.reserve(id);
+                scalar.reserve(id);
+                reference.reserve(id);
+            }
+            mt19937 random(20240601);
+            uniform_int_distribution<int32_t> ids(-100, 3 * DatarefTable::CHUNK_SIZE); // 含负数、已分配块内越界与未分配块
+            for (uint32_t serial = 1; serial <= 20000; ++serial) {
+                string pairs(random() % 184 * 8 + random() % 8, '\0'); // 末尾可能有不足一对的字节
+                for (size_t i = 0; i + 8 <= pairs.size(); i += 8)
+                    pack(pairs, i, ids(random), static_cast<uint32_t>(random())); // 任意位模式, 包括 NaN
+                decodeRref(pairs, vector, LIMIT, serial, ignore);
+                decodeRrefScalar(pairs, scalar, LIMIT, serial, ignore);
+                legacy(pairs, reference, LIMIT, serial);
+            }
+            size_t mismatches{0};
+            for (int32_t id = 0; id < LIMIT; ++id) {
+                const uint64_t expected = reference.slot(id)->load();
+                mismatches += (vector.slot(id)->load() != expected) + (scalar.slot(id)->load() != expected);
+            }
+            report.line("decode_validate", {{"packets", 20000}, {"mismatches", mismatches}});
+            // 满载数据报
+            string full(183 * 8, '\0');
+            for (size_t i = 0; i < 183; ++i)
+                pack(full, i * 8, static_cast<int32_t>(i * 7), static_cast<float>(i));
+            constexpr size_t iterations{50000};
+            const auto measure = [&](const string &bench, const function<void (uint32_t)> &op) {
+                double elapsed{numeric_limits<double>::max()};
+                for (int round = 0; round < 5; ++round) { // 取最快一轮, 减少调度干扰
+                    const auto start = Clock::now();
+                    for (uint32_t i = 1; i <= iterations; ++i)
+                        op(i);
+                    elapsed = min(elapsed, nanosecondsSince(start));
+                }
+                report.line(bench, {
+                                {"pairs", iterations * 183}, {"ns_per_pair", elapsed / iterations / 183},
+                                {"pairs_per_s", iterations * 183 * 1e9 / elapsed}
+                            });
+            };
+            measure("decode_rref_simd", [&](const uint32_t serial) { decodeRref(full, vector, LIMIT, serial, ignore); });
+            measure("decode_rref_scalar", [&](const uint32_t serial) {
+                decodeRrefScalar(full, scalar, LIMIT, serial, ignore);
+            });
+            measure("decode_rref_legacy", [&](const uint32_t serial) { legacy(full, reference, LIMIT, serial); });
+            return mismatches == 0;
+        }
+
+        /**
+         * @brief 读取延迟, N 个线程同时读取, 期间 io 线程照常接收
+         */
+        void read () {
+            const string scalar{"bench/read/scalar"}, array{"bench/read/array"};
+            const auto handle = xp.addDataref(scalar, 50);
+            const auto arrayHandle = xp.addDatarefArray(array, 16, 50);
+            constexpr CatalogRef catalogRef = DatarefCatalog::ref("sim/flightmodel/position/latitude");
+            const string catalogName{DatarefCatalog::entry(catalogRef.entry).name};
+            const auto catalogHandle = xp.addDataref(catalogRef, 50);
+            const int32_t id = handle.id();
+            for (const auto start = Clock::now(); !handle.get() || !arrayHandle.get() || !catalogHandle.get();) {
+                if (Clock::now() - start > chrono::seconds(5))
+                    throw runtime_error("No data received for read benchmark.");
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+            const vector<pair<string, function<float ()>>> cases{
+                {"get_dataref_name", [&] () { return xp.getDataref(scalar).value_or(0); }},
+                {"get_dataref_id", [&] () { return xp.getDataref(id).value_or(0); }},
+                {"get_dataref_catalog", [&] () { return xp.getDataref(catalogRef).value_or(0); }},
+                {"get_dataref_catalog_name", [&] () { return xp.getDataref(catalogName).value_or(0); }},
+                {"handle_get", [&] () { return handle.get().value_or(0); }},
+                {"get_dataref_array", [&] () { return xp.getDatarefArray(array).value_or(vector<float>{0})[0]; }},
+                {"array_handle_get", [&] () { return arrayHandle.get().value_or(vector<float>{0})[0]; }},
+                {"get_dataref_array_into", [&] () {
+                    std::array<float, 16> out{};
+                    xp.getDatarefArray(array, out);
+                    return out[0];
+                }},
+                {"array_handle_read", [&] () {
+                    std::array<float, 16> out{};
+                    arrayHandle.read(out);
+                    return out[0];
+                }},
+            };
+            const unsigned maxThreads = max(1u, min(8u, thread::hardware_concurrency()));
+            for (const auto &[name, op] : cases) {
+                for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+                    constexpr size_t iterations{200000};
+                    atomic<bool> go{false};
+                    vector<double> perThread(threads);
+                    vector<thread> workers;
+                    for (unsigned t = 0; t < threads; ++t)
+                        workers.emplace_back([&, t] () {
+                            while (!go.load())
+                                this_thread::yield();
+                            volatile float sink{0};
+                            const auto start = Clock::now();
+                            for (size_t i = 0; i < iterations; ++i)
+                                sink = sink + op();
+                            perThread[t] = nanosecondsSince(start) / iterations;
+                        });
+                    go.store(true);
+                    for (auto &worker : workers)
+                        worker.join();
+                    const double mean = accumulate(perThread.begin(), perThread.end(), 0.0) / threads;
+                    report.line("read_" + name, {
+                                    {"threads", threads}, {"ns_per_op", mean},
+                                    {"ns_per_op_max", *max_element(perThread.begin(), perThread.end())},
+                                    {"ops_per_s", threads * 1e9 / mean}
+                                });
+                }
+            }
+        }
+
+        /**
+         * @brief 共享内存: 发布对解析的额外开销与读者的读取延迟
+         */
+        void shared () {
+            xp.startSharedMemory("XPlaneUDPBench");
+            SharedReader reader("XPlaneUDPBench");
+            const string name{"bench/shared/scalar"};
+            const auto source = xp.addDataref(name, 50);
+            constexpr size_t PAIRS{183}, iterations{100000};
+            UdpBuffer buffer{};
+            size_t length = pack(buffer, 0, string{"RREF", 5});
+            for (size_t i = 0; i < PAIRS; ++i)
+                length = pack(buffer, length, source.id(), static_cast<float>(i));
+            const string_view packet{buffer.data(), length};
+            const double elapsed = onIo([&] () {
+                for (size_t i = 0; i < iterations; ++i)
+                    xp.handleReceive(packet);
+            });
+            report.line("shared_publish", {
+                            {"pairs", PAIRS}, {"ns_per_packet", elapsed / iterations},
+                            {"ns_per_pair", elapsed / iterations / PAIRS}
+                        });
+            const auto handle = reader.handle(name);
+            const vector<pair<string, function<float ()>>> cases{
+                {"get_dataref_name", [&] () { return reader.getDataref(name).value_or(0); }},
+                {"handle_get", [&] () { return handle.get().value_or(0); }},
+            };
+            for (const auto &[bench, op] : cases) {
+                constexpr size_t reads{1000000};
+                volatile float sink{0};
+                const auto start = Clock::now();
+                for (size_t i = 0; i < reads; ++i)
+                    sink = sink + op();
+                report.line("shared_read_" + bench, {{"ns_per_op", nanosecondsSince(start) / reads}});
+            }
+            xp.stopSharedMemory();
+        }
+
+        /**
+         * @brief 飞行记录编码: 30 万个样本写入后逐位比对读出, 再截去末块尾部确认只丢弃该块
+         * 值含 NaN/无穷/-0/非规格化数与随机值, 接收时间含抖动与长时间中断, 中途退订一列
+         * @return 结果一致
+         */
+        bool recordCheck () {
+            constexpr size_t PACKETS{120000};
+            const string path = (filesystem::temp_directory_path() / "XPlaneUDPBenchCheck.rec").string();
+            const array<float, 6> special{
+                numeric_limits<float>::quiet_NaN(), numeric_limits<float>::infinity(),
+                -numeric_limits<float>::infinity(), -0.0f, numeric_limits<float>::denorm_min(), 1.0f
+            };
+            mt19937 random(20240601);
+            uniform_real_distribution<float> values(-1e6f, 1e6f);
+            vector<vector<pair<int64_t, float>>> expected(3);
+            uint64_t written;
+            {
+                RecordWriter writer(path);
+                writer.name(3, "check/a", 0);
+                writer.name(7, "check/b", 0);
+                writer.name(9, "check/c", 0);
+                writer.name(11, "check/array", 4); // 数组本名不记录
+                int64_t time = chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+                for (size_t p = 0; p < PACKETS; ++p) {
+                    if (p == PACKETS / 2)
+                        writer.name(-1, "check/c", 0);
+                    time += (p % 10000 == 9999) ? 5000000000 : 50000000 + static_cast<int64_t>(random() % 2000000);
+                    const array<float, 3> sample{
+                        (p % 5 == 0) ? special[p / 5 % special.size()] : values(random),
+                        static_cast<float>(sin(0.01 * static_cast<double>(p))),
+                        static_cast<float>(p % 100)
+                    };
+                    UdpBuffer buffer{};
+                    const size_t length = pack(buffer, 0, 3, sample[0], 7, sample[1], 9, sample[2], 42, 0.0f);
+                    writer.recordPairs({buffer.data(), length}, time);
+                    for (size_t i = 0; i < sample.size(); ++i)
+                        if ((i != 2) || (p < PACKETS / 2))
+                            expected[i].emplace_back(time, sample[i]);
+                }
+                written = writer.close();
+            }
+            // 写入时按微秒取整, 接收时刻与首个样本之差允许 1us 误差
+            const auto compare = [&] (const RecordReader &reader, const size_t limit) {
+                size_t mismatches{0};
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    const auto samples = reader.read("check/" + string(1, static_cast<char>('a' + i)));
+                    const size_t count = min(limit, expected[i].size());
+                    mismatches += (samples.size() != count);
+                    for (size_t k = 0; k < min(count, samples.size()); ++k) {
+                        const auto value = static_cast<float>(samples[k].value);
+                        const int64_t time = (samples[k].time - samples[0].time).count() / 1000;
+                        const int64_t reference = (expected[i][k].first - expected[i][0].first) / 1000;
+                        mismatches += (memcmp(&value, &expected[i][k].second, sizeof(value)) != 0) ||
+                                      (abs(time - reference) > 1);
+                    }
+                }
+                return mismatches + (reader.column("check/array") >= 0);
+            };
+            size_t mismatches{0}, chunks{0};
+            {
+                const RecordReader reader(path);
+                mismatches += compare(reader, PACKETS) + (written != expected[0].size() * 2 + expected[2].size());
+                chunks = reader.chunks();
+            }
+            // 截去末块的一部分, 模拟写入中断
+            filesystem::resize_file(path, filesystem::file_size(path) - 64);
+            size_t truncated{0};
+            {
+                const RecordReader reader(path);
+                truncated = reader.read("check/a").size();
+                mismatches += (reader.chunks() + 1 != chunks) || (truncated == 0) || (truncated >= PACKETS);
+                mismatches += compare(reader, truncated);
+            }
+            filesystem::remove(path);
+            report.line("record_validate", {
+                            {"samples", written}, {"chunks", chunks}, {"truncated_samples", truncated},
+                            {"mismatches", mismatches}
+                        });
+            return mismatches == 0;
+        }
+
+        /**
+         * @brief 飞行记录: 记录对解析的额外开销, 缓变数据的压缩率与按列读出速率
+         * 接收时间按 20Hz 加抖动推进, 值为各不相同的缓变正弦; 每 100 个包 (一块) 后暂停, 后台线程如实际一样跟得上, 只计解析耗时
+         */
+        void record () {
+            constexpr size_t PAIRS{183}, PACKETS{20000};
+            vector<int32_t> ids;
+            for (size_t i = 0; i < PAIRS; ++i)
+                ids.push_back(xp.addDataref("bench/record/" + to_string(i)).id());
+            vector<string> packets;
+            for (size_t p = 0; p < PACKETS; ++p) {
+                UdpBuffer buffer{};
+                size_t length = pack(buffer, 0, string{"RREF", 5});
+                for (size_t i = 0; i < PAIRS; ++i)
+                    length = pack(buffer, length, ids[i], static_cast<float>(100 * sin(0.001 * p * (i + 1))));
+                packets.emplace_back(buffer.data(), length);
+            }
+            const auto run = [&] () {
+                mt19937 jitter(1);
+                double elapsed{0};
+                onIo([&] () {
+                    for (size_t p = 0; p < PACKETS; ++p) {
+                        xp.receiveTime += 50000000 + static_cast<int64_t>(jitter() % 2000000);
+                        const auto start = Clock::now();
+                        xp.handleReceive(packets[p]);
+                        elapsed += nanosecondsSince(start);
+                        if (p % 100 == 99)
+                            this_thread::sleep_for(chrono::milliseconds(2));
+                    }
+                });
+                return elapsed;
+            };
+            const double base = run();
+            const string path = (filesystem::temp_directory_path() / "XPlaneUDPBench.rec").string();
+            xp.startRecording(path);
+            const double recorded = run();
+            const uint64_t samples = xp.stopRecording();
+            const auto bytes = filesystem::file_size(path);
+            report.line("record", {
+                            {"pairs", PAIRS}, {"packets", PACKETS}, {"ns_per_packet", recorded / PACKETS},
+                            {"overhead_ns_per_pair", (recorded - base) / PACKETS / PAIRS}, {"samples", samples},
+                            {"bytes_per_sample", static_cast<double>(bytes) / samples}
+                        });
+            {
+                const RecordReader reader(path);
+                size_t read{0};
+                const auto start = Clock::now();
+                for (size_t i = 0; i < reader.columns().size(); ++i)
+                    read += reader.read(static_cast<int32_t>(i)).size();
+                report.line("record_read", {{"samples", read}, {"ns_per_sample", nanosecondsSince(start) / read}});
+            }
+            filesystem::remove(path);
+            for (size_t i = 0; i < PAIRS; ++i)
+                xp.removeDataref("bench/record/" + to_string(i), 1);
+        }
+
+        /**
+         * @brief 写入开销: 调用方耗时与全部发出的耗时
+         */
+        void send () {
+            const auto measure = [&] (const string &bench, const size_t calls, const size_t packets,
+                                      const function<void (size_t)> &op) {
+                const auto start = Clock::now();
+                for (size_t i = 0; i < calls; ++i)
+                    op(i);
+                const double caller = nanosecondsSince(start);
+                promise<void> done;
+                xp.setDataref("bench/send/fence", 0, -1, [&done] (const sys::error_code &) { done.set_value(); });
+                done.get_future().wait(); // 发送队列按序发出, 栅栏发出即全部发出
+                const double total = nanosecondsSince(start);
+                report.line(bench, {
+                                {"calls", calls}, {"packets", packets},
+                                {"caller_ns_per_call", caller / calls},
+                                {"total_ns_per_packet", total / packets},
+                                {"packets_per_s", packets * 1e9 / total}
+                            });
+            };
+            measure("send_dataref", 200000, 200000, [&] (const size_t i) {
+                xp.setDataref("bench/send/scalar", static_cast<float>(i));
+            });
+            const vector<float> values(16, 1.0f);
+            measure("send_dataref_array", 20000, 20000 * values.size(), [&] (size_t) {
+                xp.setDatarefArray("bench/send/array", values);
+            });
+        }
+
+        /**
+         * @brief 端到端延迟: 本地 socket 直接向 XPlaneUdp 发 RREF, 计到句柄读到新值为止
+         */
+        void latency () {
+            const auto handle = xp.addDataref("bench/latency", 1);
+            asio::io_context context;
+            ip::udp::socket sender(context, ip::udp::endpoint(ip::udp::v4(), 0));
+            const ip::udp::endpoint target(ip::make_address("127.0.0.1"), xp.localSocket.local_endpoint().port());
+            constexpr size_t samples{20000};
+            vector<double> latencies;
+            latencies.reserve(samples);
+            size_t lost{0};
+            for (size_t i = 1; i <= samples; ++i) {
+                array<char, 13> buffer{};
+                const float value = static_cast<float>(i) + 0.5f; // 与模拟器发来的值区分
+                const size_t length = pack(buffer, 0, string{"RREF", 5}, handle.id(), value);
+                const auto start = Clock::now();
+                sender.send_to(asio::buffer(buffer.data(), length), target);
+                while (handle.get() != value) {
+                    if (Clock::now() - start > chrono::milliseconds(100)) {
+                        ++lost;
+                        break;
+                    }
+                }
+                if (handle.get() == value)
+                    latencies.push_back(nanosecondsSince(start));
+            }
+            if (latencies.empty())
+                return;
+            sort(latencies.begin(), latencies.end());
+            const auto percentile = [&] (const double p) {
+                return latencies[min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+            };
+            report.line("latency_loopback", {
+                            {"samples", latencies.size()}, {"lost", lost},
+                            {"mean_ns", accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size()},
+                            {"p50_ns", percentile(0.5)}, {"p90_ns", percentile(0.9)}, {"p99_ns", percentile(0.99)},
+                            {"max_ns", latencies.back()}
+                        });
+        }
+        /**
+         * @brief 共享线程池吞吐: 每个实例一个发送线程持续灌入 183 对的 RREF, 计各实例合计处理的数据报
+         * 线程数取实例数与核数的较小者, 发送线程同样占用核
+         */
+        void engine () {
+            constexpr size_t MAX_PAIRS{183};
+            XPlaneSim peer(0, false); // 只接收订阅
+            const ip::udp::endpoint endpoint(ip::make_address("127.0.0.1"), peer.port());
+            const size_t cores = max<size_t>(thread::hardware_concurrency(), 1);
+            for (const size_t count : {1, 2, 4}) {
+                XPlaneEngine engine(min(count, cores), false);
+                vector<unique_ptr<XPlaneUdp>> instances;
+                vector<string> packets;
+                for (size_t n = 0; n < count; ++n) {
+                    instances.push_back(make_unique<XPlaneUdp>(engine, endpoint));
+                    UdpBuffer buffer{};
+                    size_t length = pack(buffer, 0, string{"RREF", 5});
+                    for (size_t i = 0; i < MAX_PAIRS; ++i)
+                        length = pack(buffer, length, instances.back()->addDataref("bench/engine/" + to_string(i)).id(),
+                                      static_cast<float>(i));
+                    packets.emplace_back(buffer.data(), length);
+                }
+                atomic<bool> running{true};
+                vector<thread> senders;
+                for (size_t n = 0; n < count; ++n)
+                    senders.emplace_back([&, n] () {
+                        asio::io_context context;
+                        ip::udp::socket sender(context, ip::udp::endpoint(ip::udp::v4(), 0));
+                        const ip::udp::endpoint target(ip::make_address("127.0.0.1"),
+                                                       instances[n]->localSocket.local_endpoint().port());
+                        sys::error_code error;
+                        while (running.load(memory_order_relaxed))
+                            sender.send_to(asio::buffer(packets[n]), target, 0, error);
+                    });
+                const auto datagrams = [&] () {
+                    uint64_t total{0};
+                    for (const auto &instance : instances)
+                        total += instance->metrics().datagrams;
+                    return total;
+                };
+                this_thread::sleep_for(chrono::milliseconds(200)); // 预热
+                const uint64_t before = datagrams();
+                const auto start = Clock::now();
+                this_thread::sleep_for(chrono::seconds(1));
+                const uint64_t received = datagrams() - before;
+                const double elapsed = nanosecondsSince(start);
+                running.store(false);
+                for (auto &sender : senders)
+                    sender.join();
+                instances.clear();
+                report.line("engine", {
+                                {"instances", count}, {"threads", min(count, cores)},
+                                {"datagrams_per_s", received * 1e9 / elapsed},
+                                {"pairs_per_s", received * MAX_PAIRS * 1e9 / elapsed}
+                            });
+            }
+        }
+
+        /**
+         * @brief 运行统计快照, 统计编译关闭时全为 0
+         */
+        void metrics () {
+            const MetricsSnapshot snapshot = xp.metrics();
+            report.line("metrics", {
+                            {"datagrams", snapshot.datagrams}, {"bytes", snapshot.bytes},
+                            {"rref_pairs", snapshot.rrefPairs}, {"unknown_pairs", snapshot.unknownPairs},
+                            {"rpos_frames", snapshot.rposFrames}, {"data_records", snapshot.dataRecords},
+                            {"unknown_records", snapshot.unknownRecords}, {"sends", snapshot.sends},
+                            {"send_errors", snapshot.sendErrors}, {"resubscribes", snapshot.resubscribes},
+                            {"stale_resubscribes", snapshot.staleResubscribes},
+                            {"never_received", snapshot.neverReceived}, {"id_limit", snapshot.idLimit},
+                            {"handler_p50_ns", snapshot.handlerTime.percentile(0.5)},
+                            {"handler_p99_ns", snapshot.handlerTime.percentile(0.99)},
+                            {"inter_arrival_p50_ns", snapshot.interArrival.percentile(0.5)},
+                            {"value_age_p99_ns", snapshot.valueAge.percentile(0.99)}
+                        });
+        }
+    private:
+        XPlaneUdp &xp;
+        Report &report;
+
+        /**
+         * @brief 在 io 线程上执行并计时
+         * @return 耗时 ns
+         */
+        template <typename F>
+        double onIo (F &&f) {
+            promise<double> elapsed;
+            asio::post(xp.strand_, [&] () {
+                const auto start = Clock::now();
+                f();
+                elapsed.set_value(nanosecondsSince(start));
+            });
+            return elapsed.get_future().get();
+        }
+};
+
+int main (const int argc, char* argv[]) {
+    ofstream file;
+    if (argc > 1)
+        file.open(argv[1]);
+    Report report(argc > 1 ? file : cout);
+    XPlaneSim sim(0); // 系统分配端口, 由 BECN 告知
+    XPlaneUdp xp;
+    XPlaneUdpBench bench(xp, report);
+    report.line("meta", {{"hardware_concurrency", thread::hardware_concurrency()}});
+    const bool decoded = bench.decode();
+    bench.parse();
+    bench.read();
+    bench.shared();
+    const bool recorded = bench.recordCheck();
+    bench.record();
+    bench.send();
+    bench.latency();
+    bench.metrics();
+    bench.engine();
+    return (decoded && recorded) ? 0 : 1;
+}
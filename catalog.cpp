@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "DatarefCatalog.hpp"
+
+// 用法: XPlaneCatalog <DataRefs.txt> <输出头文件>
+// 把 X-Plane 的 DataRefs.txt (名称 类型 可写 单位 说明, 制表符分隔) 生成为 DatarefCatalog.hpp 使用的编目数据
+
+using namespace std;
+
+struct Entry {
+    string name;
+    string type;
+    int32_t length;
+    bool writable;
+};
+
+/**
+ * @brief 解析类型列, 如 float / int[8] / byte[260]
+ * @return 是否为可识别的类型
+ */
+static bool parseType (const string &text, string &type, int32_t &length) {
+    const size_t open = text.find('[');
+    const string base = text.substr(0, open);
+    length = 0;
+    if (open != string::npos) {
+        try {
+            length = stoi(text.substr(open + 1));
+        } catch (const exception &) {
+            return false;
+        }
+        if (length <= 0)
+            return false;
+    }
+    if (base == "int")
+        type = "INT";
+    else if (base == "float")
+        type = "FLOAT";
+    else if (base == "double")
+        type = "DOUBLE";
+    else if (base == "byte")
+        type = "BYTE";
+    else if (base == "data")
+        type = "DATA";
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief 读取 DataRefs.txt, 跳过版本行与无法识别的行, 同名只保留第一项
+ */
+static vector<Entry> load (istream &in) {
+    vector<Entry> entries;
+    set<string> seen;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && (line.back() == '\r'))
+            line.pop_back();
+        istringstream fields(line);
+        string name, type, writable;
+        if (!getline(fields, name, '\t') || !getline(fields, type, '\t'))
+            continue;
+        getline(fields, writable, '\t');
+        Entry entry{name, "", 0, writable == "y"};
+        if ((name.find('/') == string::npos) || !parseType(type, entry.type, entry.length))
+            continue;
+        if (seen.insert(name).second)
+            entries.push_back(entry);
+    }
+    return entries;
+}
+
+/**
+ * @brief 分桶后按桶大小从大到小, 为每个桶找一个种子使桶内名称落在互不相同的空位
+ * @param seeds 每个桶的种子
+ * @param table 位置 -> 条目序号
+ * @return 是否成功
+ */
+static bool build (const vector<Entry> &entries, vector<uint32_t> &seeds, vector<int32_t> &table) {
+    const size_t n = entries.size();
+    seeds.assign(max<size_t>((n + 3) / 4, 1), 0);
+    table.assign(n, -1);
+    vector<vector<int32_t>> buckets(seeds.size());
+    for (size_t i = 0; i < n; ++i)
+        buckets[DatarefCatalog::hash(entries[i].name, 0) % seeds.size()].push_back(static_cast<int32_t>(i));
+    vector<size_t> order(buckets.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&buckets] (const size_t a, const size_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+    vector<size_t> positions;
+    for (const size_t bucket : order) {
+        if (buckets[bucket].empty())
+            break;
+        bool placed = false;
+        for (uint32_t seed = 1; (seed < 10000000) && !placed; ++seed) {
+            positions.clear();
+            placed = true;
+            for (const int32_t index : buckets[bucket]) {
+                const size_t position = DatarefCatalog::hash(entries[index].name, seed) % n;
+                if ((table[position] >= 0) || (find(positions.begin(), positions.end(), position) != positions.end())) {
+                    placed = false;
+                    break;
+                }
+                positions.push_back(position);
+            }
+            if (placed) {
+                seeds[bucket] = seed;
+                for (size_t i = 0; i < positions.size(); ++i)
+                    table[positions[i]] = buckets[bucket][i];
+            }
+        }
+        if (!placed)
+            return false;
+    }
+    return true;
+}
+
+int main (const int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "usage: XPlaneCatalog <DataRefs.txt> <output header>" << endl;
+        return 1;
+    }
+    ifstream in(argv[1]);
+    if (!in) {
+        cerr << "cannot open " << argv[1] << endl;
+        return 1;
+    }
+    vector<Entry> entries = load(in);
+    if (entries.empty()) {
+        cerr << "no datarefs found in " << argv[1] << endl;
+        return 1;
+    }
+    sort(entries.begin(), entries.end(), [] (const Entry &a, const Entry &b) { return a.name < b.name; });
+    vector<uint32_t> seeds;
+    vector<int32_t> table;
+    if (!build(entries, seeds, table)) {
+        cerr << "perfect hash construction failed" << endl;
+        return 1;
+    }
+    ostringstream out;
+    out << "// 由 XPlaneCatalog 从 DataRefs.txt 生成, 勿手工修改; 仅由 DatarefCatalog.hpp 包含\n"
+           "// " << entries.size() << " 项\n"
+           "namespace catalog_data {\n";
+    int32_t slots{0};
+    out << "    constexpr std::array<CatalogEntry, " << entries.size() << "> ENTRIES{{\n";
+    for (const Entry &entry : entries) {
+        out << "        {\"" << entry.name << "\", CatalogType::" << entry.type << ", " << entry.length << ", "
+            << (entry.writable ? "true" : "false") << ", " << slots << "},\n";
+        slots += 1 + entry.length;
+    }
+    out << "    }};\n";
+    out << "    constexpr int32_t SLOTS{" << slots << "};\n";
+    const auto list = [&out] (const auto &values) {
+        for (size_t i = 0; i < values.size(); ++i)
+            out << ((i % 16 == 0) ? "\n        " : " ") << values[i] << ',';
+        out << "\n    }};\n";
+    };
+    out << "    constexpr std::array<uint32_t, " << seeds.size() << "> SEEDS{{";
+    list(seeds);
+    out << "    constexpr std::array<int32_t, " << table.size() << "> TABLE{{";
+    list(table);
+    out << "}\n";
+    // 内容不变时不改写, 避免依赖它的文件重新编译
+    ifstream previous(argv[2]);
+    if (previous && (string(istreambuf_iterator<char>(previous), {}) == out.str()))
+        return 0;
+    ofstream file(argv[2], ios::trunc);
+    file << out.str();
+    if (!file) {
+        cerr << "cannot write " << argv[2] << endl;
+        return 1;
+    }
+    cout << entries.size() << " datarefs, " << slots << " slots" << endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <array>
+#include <charconv>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "XPlaneRecorder.hpp"
+
+// 用法: XPlaneExport <记录文件> [起始秒 结束秒 [dataref...]]
+// 只给记录文件时列出各列与样本数; 给出时间范围时以 CSV 输出到标准输出, 每个接收时刻一行, 未更新的列留空
+// 时间为相对记录开始的秒, "-" 表示不限; 不指定 dataref 时导出全部列
+
+using namespace std;
+
+static chrono::nanoseconds seconds (const string &text, const chrono::nanoseconds unbounded) {
+    if (text == "-")
+        return unbounded;
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double>(stod(text)));
+}
+
+/**
+ * @brief 最短可还原的十进制表示, FLOAT 列按 float 输出
+ */
+static void print (ostream &out, const double value, const RecordType type) {
+    array<char, 32> text{};
+    const auto result = (type == RecordType::FLOAT)
+                            ? to_chars(text.data(), text.data() + text.size(), static_cast<float>(value))
+                            : to_chars(text.data(), text.data() + text.size(), value);
+    out.write(text.data(), result.ptr - text.data());
+}
+
+static int list (const RecordReader &reader) {
+    const auto wall = chrono::system_clock::to_time_t(reader.startTime());
+    cout << "started " << put_time(localtime(&wall), "%F %T") << ", "
+         << chrono::duration<double>(reader.lastTime()).count() << " s, " << reader.chunks() << " chunks" << endl;
+    const auto &columns = reader.columns();
+    for (size_t i = 0; i < columns.size(); ++i)
+        cout << columns[i].name << '\t' << ((columns[i].type == RecordType::FLOAT) ? "float" : "double") << '\t'
+             << reader.count(static_cast<int32_t>(i)) << endl;
+    return 0;
+}
+
+int main (const int argc, char* argv[]) {
+    if ((argc != 2) && (argc < 4)) {
+        cerr << "usage: XPlaneExport <recording> [from_s to_s [dataref...]]" << endl;
+        return 1;
+    }
+    try {
+        const RecordReader reader(argv[1]);
+        if (argc == 2)
+            return list(reader);
+        const auto from = seconds(argv[2], chrono::nanoseconds::zero());
+        const auto to = seconds(argv[3], chrono::nanoseconds::max());
+        vector<int32_t> selected;
+        for (int i = 4; i < argc; ++i) {
+            const int32_t column = reader.column(argv[i]);
+            if (column < 0) {
+                cerr << "not recorded: " << argv[i] << endl;
+                return 1;
+            }
+            selected.push_back(column);
+        }
+        if (selected.empty())
+            for (size_t i = 0; i < reader.columns().size(); ++i)
+                selected.push_back(static_cast<int32_t>(i));
+        vector<vector<RecordSample>> samples;
+        cout << fixed << setprecision(6) << "time_s"; // 时间为微秒精度
+        for (const int32_t column : selected) {
+            samples.push_back(reader.read(column, from, to));
+            cout << ',' << reader.columns()[column].name;
+        }
+        cout << '\n';
+        // 按时间归并各列
+        vector<size_t> cursors(selected.size(), 0);
+        while (true) {
+            auto time = chrono::nanoseconds::max();
+            for (size_t i = 0; i < samples.size(); ++i)
+                if (cursors[i] < samples[i].size())
+                    time = min(time, samples[i][cursors[i]].time);
+            if (time == chrono::nanoseconds::max())
+                break;
+            cout << chrono::duration<double>(time).count();
+            for (size_t i = 0; i < samples.size(); ++i) {
+                cout << ',';
+                if ((cursors[i] < samples[i].size()) && (samples[i][cursors[i]].time == time))
+                    print(cout, samples[i][cursors[i]++].value, reader.columns()[selected[i]].type);
+            }
+            cout << '\n';
+        }
+    } catch (const exception &error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
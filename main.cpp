@@ -1,12 +1,15 @@
 #include "XPlaneUDP.hpp"
 
+using namespace catalog_literals;
+
 int main () {
     auto xp = XPlaneUdp();
     const std::string dataref1{"sim/flightmodel/position/latitude"};
-    const std::string dataref2{"sim/flightmodel/engine/ENGN_N1_"};
+    constexpr auto dataref2 = "sim/flightmodel/engine/ENGN_N1_"_dref; // 编目中的 dataref, 编译期解析
     const std::string dataref3{"sim/cockpit/radios/com1_freq_hz"};
-    xp.addDataref(dataref1); // 读取dataref数据
-    xp.addDatarefArray(dataref2, 16); // 读取dataref数组
+    const auto lat = xp.addDataref(dataref1); // 读取dataref数据
+    xp.onUpdate(lat, [] (const float value, uint32_t) { std::cout << value << std::endl; }, 1e-4f); // 变化超过阈值时通知
+    xp.addDatarefArray(dataref2); // 读取dataref数组, 长度取自编目
     bool rev{}; // 写入dataref数据
     xp.addBasicInfo(2); // 机模基本信息
     while (true) {
@@ -14,9 +17,6 @@ int main () {
         std::cout << "-------" << std::endl;
         rev = !rev;
 
-        if (auto latId = xp.datarefName2Id(dataref1); latId.has_value())
-            if (auto lat = xp.getDataref(latId.value()); lat.has_value())
-                std::cout << lat.value() << std::endl;
         if (auto info = xp.getBasicInfo(); info.has_value())
             std::cout << info.value().lon << std::endl;
         if (auto n1 = xp.getDatarefArray(dataref2); n1.has_value())
@@ -0,0 +1,21 @@
+#include "XPlaneSim.hpp"
+
+// 用法: XPlaneSimulator [port] [capture] [speed]
+// 不带抓包文件时发送合成数据, 带抓包文件时回放, speed 为 0 时尽可能快
+int main (const int argc, char* argv[]) {
+    const auto port = static_cast<unsigned short>(argc > 1 ? std::stoi(argv[1]) : 49000);
+    XPlaneSim sim(port);
+    std::cout << "XPlaneSim listening on " << sim.port() << std::endl;
+    if (argc > 2) {
+        sim.replay(argv[2], argc > 3 ? std::stod(argv[3]) : 1.0);
+        while (sim.replaying()) // 等待客户端连接并回放完毕
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::cout << "replay finished, " << sim.sentPackets() << " packets sent" << std::endl;
+        return 0;
+    }
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        std::cout << sim.subscriptions() << " subscriptions, " << sim.sentPackets() << " packets sent" << std::endl;
+    }
+    return 0;
+}